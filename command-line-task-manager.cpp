@@ -1,27 +1,367 @@
 #include <iostream> // for input&output operations
 #include <vector> // for using the std::vector to store tasks
 #include <string> // for using std::string class for text
+#include <string_view> // for looking at descriptions inside the arena without copying
 #include <limits> // for handling input errors
+#include <map> // for the sorted token dictionary of the search index
+#include <set> // for the due date tree
+#include <unordered_map> // for the trigram table of the search index
+#include <unordered_set> // for the open connections of a daemon worker
+#include <algorithm> // for lower_bound & set intersection helpers
+#include <chrono> // for timing search queries
+#include <cctype> // for tolower/isalnum when tokenizing
+#include <cstdint> // for fixed width trigram keys
+#include <ctime> // for today's date in due date queries
+#include <cstdio> // for sscanf/snprintf on dates
+#include <cstdlib> // for atoi
+#include <cstring> // for memcpy in the wire format
+#include <csignal> // for stopping the daemon on ctrl-c
+#include <cerrno> // for EAGAIN & EINTR on sockets
+#include <shared_mutex> // for the reader-writer lock around the database
+#include <mutex> // for unique_lock
+#include <thread> // for daemon workers & load test clients
+#include <atomic> // for counters shared by load test clients
+#include <sys/socket.h> // for the unix domain socket
+#include <sys/un.h> // for sockaddr_un
+#include <sys/epoll.h> // for the daemon event loop
+#include <sys/eventfd.h> // for waking a daemon worker when a file job is done
+#include <unistd.h> // for read/write/close
+#include <fcntl.h> // for open
+#include <sys/mman.h> // for mapping import files
+#include <sys/stat.h> // for the size of import files
+#include <sys/file.h> // for flock on the autosave log
+#include <memory> // for unique_ptr
+#include <random> // for the benchmark's seeded workload
+#include <fstream> // for writing benchmark results
 
-// Task structure, grouping related variables together
+// A task id is the slot a task got when it was added. Ids only grow until
+// the store is compacted, which renumbers the live tasks 0..n-1 in the same
+// order and bumps the store's generation (see compactDatabase).
+const uint32_t NO_TASK = std::numeric_limits<uint32_t>::max();
 
-struct Task {
-    std::string description;
-    bool isCompleted;
+// Optional task fields. Due dates are whole days since 1970-01-01.
+const int8_t NO_PRIORITY = 0; // priorities go from 1 (low) to 9 (urgent)
+const int32_t NO_DUE_DATE = std::numeric_limits<int32_t>::max();
+
+// What the daemon's socket is called unless TASK_MANAGER_SOCKET says
+// otherwise. It goes in a directory only this user can enter, see
+// socketDirectory().
+const char* DEFAULT_SOCKET_NAME = "task-manager.sock";
+// Requests bigger than this are treated as garbage and drop the connection.
+const uint32_t MAX_REQUEST_SIZE = 64u << 20;
+
+// Where changes are saved unless TASK_MANAGER_LOG says otherwise, relative
+// to $HOME.
+const char* DEFAULT_LOG_NAME = ".task-manager.log";
+// Changes wait in a queue of this many entries for the autosave thread. An
+// entry is one add/complete/delete, or a whole import chunk; an import only
+// answers once its entries are on disk. So a crash, or a log that stops
+// taking writes, loses at most 2 * AUTOSAVE_QUEUE_SIZE adds, completes and
+// deletes that were already answered (what is queued plus the batch being
+// written), in practice only those of the last AUTOSAVE_IDLE_MS plus one
+// fsync. A failed write is retried AUTOSAVE_RETRIES times; after that every
+// change is refused, so nothing more is lost.
+const size_t AUTOSAVE_QUEUE_SIZE = 4096; // must be a power of two
+const int AUTOSAVE_IDLE_MS = 2;
+const int AUTOSAVE_RETRIES = 3;
+
+// Compact task storage.
+// Instead of one std::string + bool per task, every distinct description is
+// stored once (interned) in a single byte arena and tasks refer to it by
+// number. The completed & deleted flags are packed 64 to a word, so filters
+// like "count incomplete" are popcount loops the compiler can vectorize.
+struct TaskStore {
+    std::vector<char> arena;                  // all distinct descriptions, back to back
+    std::vector<uint64_t> textStart = {0};    // text number -> offset in arena, plus an end sentinel (64-bit, the arena may pass 4 GiB)
+    std::vector<uint32_t> internTable;        // open addressing hash table of text number + 1, 0 = empty
+    std::vector<uint32_t> taskText;           // task id -> text number
+    std::vector<uint64_t> liveBits;           // bit set = task exists (was not deleted)
+    std::vector<uint32_t> liveTree;           // Fenwick tree of live tasks per liveBits word, see liveBefore
+    std::vector<uint64_t> completedBits;      // bit set = task is completed
+    std::vector<int8_t> taskPriority;         // task id -> priority or NO_PRIORITY
+    std::vector<int32_t> taskDue;             // task id -> due day or NO_DUE_DATE
+    std::vector<uint32_t> taskTags;           // task id -> interned "tag1,tag2" text number
+    size_t liveCount = 0;                     // number of tasks that were not deleted
+    uint32_t generation = 0;                  // how often compaction renumbered the ids
+};
+
+// Which tasks a listing or count should look at.
+enum TaskFilter { ALL_TASKS, COMPLETED_TASKS, INCOMPLETE_TASKS };
+
+// Inverted index over the task descriptions. Every posting list is a sorted
+// vector of task ids, so lookups are a map search and multi-term queries are
+// linear merges of short lists. A delete leaves its ids in the lists, where
+// erasing them would move up to every id after them; queries skip them and
+// compaction takes them out.
+struct SearchIndex {
+    // lowercase token -> ids of tasks containing it. std::map keeps tokens
+    // sorted so a prefix query is one lower_bound plus a short walk.
+    std::map<std::string, std::vector<unsigned>, std::less<>> tokens;
+    // 3 lowercase bytes packed in an int -> ids of tasks containing them,
+    // used to narrow down substring queries before verifying them.
+    std::unordered_map<uint32_t, std::vector<unsigned>> trigrams;
+};
+
+// One entry of the priority heap. Completed & deleted tasks are not removed
+// from the heap right away, their entries go stale and are skipped on read.
+struct PriorityEntry {
+    int8_t priority;
+    uint32_t id;
+};
+
+// Secondary indexes over the optional fields. They only cover tasks that are
+// still incomplete, so "what's next" queries never have to skip done work.
+struct ScheduleIndex {
+    // (due day, id) in order: next due is a lower_bound on today, overdue is
+    // everything before it. Both are O(log n) plus the tasks returned.
+    std::set<std::pair<int32_t, uint32_t>> byDue;
+    // max-heap on priority, older tasks first on ties, see PriorityEntry
+    std::vector<PriorityEntry> priorityHeap;
+    size_t staleHeapEntries = 0;
+    // tag -> sorted ids, like the search tokens and with deleted ids left in
+    std::map<std::string, std::vector<unsigned>> byTag;
+};
+
+struct TaskJournal;
+
+// A whole task list: the store plus its indexes, behind one reader-writer
+// lock. Queries take it shared so any number of them run at the same time,
+// anything that changes tasks takes it exclusive.
+struct TaskDatabase {
+    TaskStore store;
+    SearchIndex search;
+    ScheduleIndex schedule;
+    std::shared_mutex lock;
+    TaskJournal* journal = nullptr; // where changes are saved, if anywhere
+    std::atomic<size_t> requests{0}; // handled so far, the daemon compacts once it stops moving
+};
+
+// Requests understood by handleRequest. On the socket a request is
+// [u32 size][u8 op][payload] and a response is
+// [u32 size][u8 status][u32 generation][u32 id count][u32 ids...][text],
+// where size counts the bytes after it and the ids are those of the tasks
+// listed in the text, numbered as of that store generation. Numbers are in
+// native byte order since the socket never leaves the machine.
+// Completing or deleting sends a task id, not the number the user saw: other
+// clients may add or delete tasks in between, which shifts the numbers, but
+// not the ids. Compaction does renumber them, so the generation the id was
+// listed under goes along and a request from before a compaction is refused.
+enum RequestOp : uint8_t {
+    OP_ADD = 1,       // [i8 priority][i32 due][u32 tag bytes][tags][description]
+    OP_LIST,          // [u8 TaskFilter]
+    OP_COMPLETE,      // [u32 task id][u32 generation]
+    OP_DELETE,        // [u32 task id][u32 generation]
+    OP_SEARCH,        // [query]
+    OP_NEXT_DUE,      // [u32 count]
+    OP_OVERDUE,       // nothing
+    OP_TOP_PRIORITY,  // [u32 count]
+    OP_TAGGED,        // [tag]
+    OP_COUNT,         // nothing
+    OP_IMPORT,        // [absolute path of a .csv or .jsonl file]
+    OP_EXPORT         // [absolute path of a .csv or .jsonl file]
+};
+
+enum ResponseStatus : uint8_t {
+    STATUS_OK = 0,
+    STATUS_EMPTY,     // the request was fine but there was nothing to show
+    STATUS_INVALID    // bad task number, bad payload, lost connection...
+};
+
+// What a request sends back: a status plus the text to show the user.
+struct Response {
+    uint8_t status;
+    std::string text;
+    std::vector<uint32_t> ids = {}; // the tasks listed, one per line of text in order
+    uint32_t generation = 0;        // the store generation those ids belong to
+};
+
+// How the menu reaches its tasks: through the daemon's socket, or straight
+// to a database in this process when no daemon is running.
+struct TaskClient {
+    int fd = -1;
+    TaskDatabase* local = nullptr;
+};
+
+// Records of the autosave log. On disk every record is
+// [u32 size][u32 checksum][u8 type][payload], size counting type + payload.
+// Ids are logged rather than task numbers: replaying the adds in order hands
+// out the same ids again. Compaction rewrites the log as one add per live
+// task in id order, so its ids and the renumbered ones agree.
+enum LogRecord : uint8_t {
+    LOG_ADD = 1,      // [u8 completed][i8 priority][i32 due][u32 tag bytes][tags][description]
+    LOG_COMPLETE,     // [u32 id]
+    LOG_DELETE        // [u32 id]
+};
+
+// One queue entry: the encoded records plus a sequence number that says
+// whether a producer or the writer owns the slot (see autosaveQueue).
+struct JournalSlot {
+    std::atomic<size_t> sequence;
+    std::string records;
+};
+
+// The autosave log. Changes are appended under the database lock into a
+// lock-free queue; a writer thread drains it and saves everything it found
+// with one write() and one fsync(), so a burst of changes shares one sync.
+struct TaskJournal {
+    int fd = -1;
+    std::string path;
+    std::unique_ptr<JournalSlot[]> slots;
+    std::atomic<size_t> tail{0};       // next slot a producer claims
+    size_t head = 0;                   // next slot the writer reads, writer only
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+    std::atomic<size_t> saved{0};      // entries before this ticket are on disk
+    size_t savedBytes = 0;             // length of the log up to there, writer only
+    std::atomic<bool> failed{false};   // saving gave up, changes are refused
+    // for the summary when the program stops
+    size_t batches = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
 };
 
 // Function prototypes, tells the compiler about our functions, defined later
-void addTask(std::vector<Task>& tasks);
-void viewTasks(const std::vector<Task>& tasks);
-void markTaskCompleted(std::vector<Task>& tasks);
-void deleteTask(std::vector<Task>& tasks);
+void addTask(TaskClient& client);
+bool viewTasks(TaskClient& client, TaskFilter filter, std::vector<uint32_t>* shown = nullptr,
+               uint32_t* generation = nullptr);
+void markTaskCompleted(TaskClient& client);
+void deleteTask(TaskClient& client);
+void searchTasks(TaskClient& client);
+void viewNextDue(TaskClient& client);
+void viewOverdue(TaskClient& client);
+void viewTopPriority(TaskClient& client);
+void viewTagged(TaskClient& client);
+void importFile(TaskClient& client);
+void exportFile(TaskClient& client);
 void clearInputBuffer();
 
+// request handling, shared by the daemon and the in-process mode
+Response handleRequest(TaskDatabase& db, uint8_t op, std::string_view payload);
+void formatTask(std::string& out, const TaskStore& store, uint32_t id, size_t number);
+Response importTasks(TaskDatabase& db, const std::string& path);
+Response exportTasks(TaskDatabase& db, const std::string& path);
+uint32_t insertTask(TaskDatabase& db, int8_t priority, int32_t due, const std::string& tags, std::string_view description);
+void completeTask(TaskDatabase& db, uint32_t id);
+void removeTask(TaskDatabase& db, uint32_t id);
+
+// autosave
+std::string defaultLogPath();
+std::unique_ptr<TaskJournal> openJournal(TaskDatabase& db, const std::string& path, std::string& message);
+void closeJournal(TaskJournal& journal);
+void journalRecord(TaskDatabase& db, uint8_t type, std::string_view payload);
+void appendLogRecord(std::string& out, uint8_t type, std::string_view payload);
+size_t autosaveQueue(TaskJournal& journal, std::string records);
+bool autosaveWait(TaskJournal& journal, size_t ticket);
+static bool savingFailed(const TaskDatabase& db);
+
+// compaction
+static bool worthCompacting(const TaskStore& store);
+std::string compactDatabase(TaskDatabase& db);
+
+// daemon & client side of the socket
+int runDaemon(const std::string& socketPath);
+int runLoadTest(int clients, int seconds);
+int runBenchmark(const std::string& resultPath, const std::vector<size_t>& sizes);
+std::string socketDirectory();
+int connectToDaemon(const std::string& socketPath);
+Response sendRequest(TaskClient& client, uint8_t op, const std::string& payload);
+static bool writeAll(int fd, const char* data, size_t size);
+
+// task storage helpers
+uint32_t storeAddTask(TaskStore& store, std::string_view description);
+void storeSetSchedule(TaskStore& store, uint32_t id, int8_t priority, int32_t due, std::string_view tags);
+void storeMarkCompleted(TaskStore& store, uint32_t id);
+void storeRemoveTask(TaskStore& store, uint32_t id);
+std::string_view taskDescription(const TaskStore& store, uint32_t id);
+bool isTaskCompleted(const TaskStore& store, uint32_t id);
+size_t countTasks(const TaskStore& store, TaskFilter filter);
+uint32_t taskAtPosition(const TaskStore& store, size_t position);
+bool isTaskLive(const TaskStore& store, uint32_t id);
+size_t positionOfTask(const TaskStore& store, uint32_t id);
+size_t storeMemoryBytes(const TaskStore& store);
+static std::string_view textOf(const TaskStore& store, uint32_t text);
+static uint32_t hashText(std::string_view text);
+
+// schedule index helpers
+void scheduleTask(ScheduleIndex& schedule, const TaskStore& store, uint32_t id);
+void unscheduleTask(ScheduleIndex& schedule, const TaskStore& store, uint32_t id);
+std::vector<uint32_t> nextDue(const ScheduleIndex& schedule, int32_t fromDay, size_t limit);
+std::vector<uint32_t> overdue(const ScheduleIndex& schedule, int32_t today);
+std::vector<uint32_t> topPriority(ScheduleIndex& schedule, const TaskStore& store, size_t limit);
+int32_t today();
+int32_t parseDate(std::string_view text);
+std::string formatDate(int32_t day);
+size_t formatDateTo(char* out, int32_t day);
+std::string normalizeTags(const std::string& text);
+template <typename Fn>
+static void forEachTag(std::string_view tags, Fn fn);
+
+// search index helpers
+void indexTask(SearchIndex& index, uint32_t id, std::string_view description);
+void addTokenPostings(SearchIndex& index, uint32_t id, std::string_view word);
+void addTrigramPosting(SearchIndex& index, uint32_t id, uint32_t gram);
+static std::vector<std::string> splitWords(std::string_view text);
+static std::vector<std::string> tokenize(std::string_view text);
+static std::vector<uint32_t> trigramsOf(std::string_view text);
+static void dropDeleted(const TaskStore& store, std::vector<unsigned>& ids);
+std::vector<unsigned> runQuery(const TaskStore& store, const SearchIndex& index, const std::string& query);
+static void addPosting(std::vector<unsigned>& list, unsigned id);
+
 //main function, entry point of program
+//  task-manager                       interactive menu (talks to the daemon if one runs)
+//  task-manager --daemon              serve the task list on the socket
+//  task-manager --loadtest [n] [sec]  hammer a private daemon with n clients
+//  task-manager --bench [file] [sizes...]  time every operation in this process,
+//                                     results go to file as JSON
+
+int main(int argc, char* argv[]) {
+    // the socket path can be moved with an environment variable
+    const char* socket_env = std::getenv("TASK_MANAGER_SOCKET");
+    std::string socket_path = socket_env ? socket_env : socketDirectory() + "/" + DEFAULT_SOCKET_NAME;
+
+    std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "--daemon") {
+        return runDaemon(socket_path);
+    }
+    if (mode == "--loadtest") {
+        int clients = argc > 2 ? std::atoi(argv[2]) : 64;
+        int seconds = argc > 3 ? std::atoi(argv[3]) : 5;
+        return runLoadTest(clients, seconds);
+    }
+    if (mode == "--bench") {
+        std::string result_path = argc > 2 ? argv[2] : "task-manager-bench.json";
+        std::vector<size_t> sizes;
+        for (int i = 3; i < argc; ++i) {
+            sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+        }
+        if (sizes.empty()) {
+            sizes = {1000, 100000, 10000000};
+        }
+        return runBenchmark(result_path, sizes);
+    }
+    if (!mode.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--daemon | --loadtest [clients] [seconds] | --bench [file] [sizes...]]" << std::endl;
+        return 1;
+    }
 
-int main() {
-    //std::vector is a dynamic array that holds all task objs.
-    std::vector<Task> task_list;
+    // the menu is only a client: use the daemon if there is one, otherwise
+    // keep the tasks in this process for as long as it runs
+    TaskDatabase local_database;
+    std::unique_ptr<TaskJournal> journal;
+    TaskClient client;
+    client.fd = connectToDaemon(socket_path);
+    // a daemon that hangs up (or turns us away) must show up as a lost
+    // connection, not kill the menu
+    std::signal(SIGPIPE, SIG_IGN);
+    if (client.fd < 0) {
+        client.local = &local_database;
+        std::string message;
+        journal = openJournal(local_database, defaultLogPath(), message);
+        if (!journal) {
+            message += "Changes will not be saved.\n";
+        }
+        std::cout << "(no task daemon at " << socket_path << ", using the tasks in this program)\n" << message;
+    }
     // variable to store usrs menu choice
     int choice;
 
@@ -33,7 +373,16 @@ int main() {
         std::cout << "2. View all tasks\n";
         std::cout << "3. Mark a task as completed\n";
         std::cout << "4. Delete a task\n";
-        std::cout << "5. Exit\n";
+        std::cout << "5. Search tasks\n";
+        std::cout << "6. View completed tasks\n";
+        std::cout << "7. View incomplete tasks\n";
+        std::cout << "8. View next tasks due\n";
+        std::cout << "9. View overdue tasks\n";
+        std::cout << "10. View top priority tasks\n";
+        std::cout << "11. View tasks with a tag\n";
+        std::cout << "12. Import tasks from a CSV or JSON Lines file\n";
+        std::cout << "13. Export tasks to a CSV or JSON Lines file\n";
+        std::cout << "14. Exit\n";
         std::cout << "Enter your choice: ";
 
         //read user choice from charstream
@@ -46,74 +395,165 @@ int main() {
 
         switch(choice) {
             case 1:
-                addTask(task_list);
+                addTask(client);
                 break;
             case 2:
-                viewTasks(task_list);
+                viewTasks(client, ALL_TASKS);
                 break;
             case 3:
-                markTaskCompleted(task_list);
+                markTaskCompleted(client);
                 break;
             case 4:
-                deleteTask(task_list);
+                deleteTask(client);
                 break;
             case 5:
+                searchTasks(client);
+                break;
+            case 6:
+                viewTasks(client, COMPLETED_TASKS);
+                break;
+            case 7:
+                viewTasks(client, INCOMPLETE_TASKS);
+                break;
+            case 8:
+                viewNextDue(client);
+                break;
+            case 9:
+                viewOverdue(client);
+                break;
+            case 10:
+                viewTopPriority(client);
+                break;
+            case 11:
+                viewTagged(client);
+                break;
+            case 12:
+                importFile(client);
+                break;
+            case 13:
+                exportFile(client);
+                break;
+            case 14:
                 std::cout << "Exiting the program. Goodbye!\n";
                 break;
             default:
                 std::cout << "Invalid choice, please try again.\n";
                 break;
         }
-    } while (choice != 5); //loop continue until user choose 5
+    } while (choice != 14); //loop continue until user choose 14
 
+    if (client.fd >= 0) {
+        close(client.fd);
+    }
+    if (journal) {
+        closeJournal(*journal); // waits for the last changes to reach the disk
+    }
     return 0;
 }
 
 // function defenitions
 
-//add task to the vector function
-void addTask(std::vector<Task>& tasks) {
+// little helpers to build request payloads
+static void appendU32(std::string& out, uint32_t value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static std::string addPayload(int8_t priority, int32_t due, const std::string& tags, const std::string& description) {
+    std::string payload;
+    payload += static_cast<char>(priority);
+    payload.append(reinterpret_cast<const char*>(&due), sizeof(due));
+    appendU32(payload, static_cast<uint32_t>(tags.size()));
+    payload += tags;
+    payload += description;
+    return payload;
+}
+
+static std::string countPayload(int count) {
+    std::string payload;
+    appendU32(payload, static_cast<uint32_t>(count));
+    return payload;
+}
+
+// the task to complete or delete, with the generation it was listed under
+static std::string taskPayload(uint32_t id, uint32_t generation) {
+    std::string payload;
+    appendU32(payload, id);
+    appendU32(payload, generation);
+    return payload;
+}
+
+// ask for a positive count, returns 0 on bad input
+static int readCount() {
+    int count;
+    std::cout << "How many tasks? ";
+    std::cin >> count;
+    clearInputBuffer();
+    if (!std::cin || count <= 0) {
+        std::cin.clear();
+        std::cout << "Invalid count. Please try again.\n";
+        return 0;
+    }
+    return count;
+}
+
+//add task function, asks for the fields and sends them off
+void addTask(TaskClient& client) {
     std::string description; //var to hold desc string
     std::cout << "Enter the task defenition: ";
     std::getline(std::cin, description); //get entire line & assign to desc
 
-    //create new task obj
-    Task newTask;
-    newTask.description = description;
-    newTask.isCompleted = false;
+    // the other fields are optional, an empty line skips them
+    std::string line;
+    int8_t priority = NO_PRIORITY;
+    std::cout << "Priority 1-9 (empty for none): ";
+    std::getline(std::cin, line);
+    if (!line.empty()) {
+        int value = std::atoi(line.c_str());
+        if (value >= 1 && value <= 9) {
+            priority = static_cast<int8_t>(value);
+        } else {
+            std::cout << "Invalid priority, leaving it empty.\n";
+        }
+    }
+
+    int32_t due = NO_DUE_DATE;
+    std::cout << "Due date YYYY-MM-DD (empty for none): ";
+    std::getline(std::cin, line);
+    if (!line.empty()) {
+        due = parseDate(line);
+        if (due == NO_DUE_DATE) {
+            std::cout << "Invalid date, leaving it empty.\n";
+        }
+    }
 
-    tasks.push_back(newTask); //add new task to end of vector
+    std::cout << "Tags separated by commas (empty for none): ";
+    std::getline(std::cin, line);
+    std::string tags = normalizeTags(line);
 
-    std::cout << "Task successfully added!\n";
+    std::cout << sendRequest(client, OP_ADD, addPayload(priority, due, tags, description)).text;
 }
 
-// display all tasks function
-void viewTasks(const std::vector<Task>& tasks) {
-    // Check if the vector is empty.
-    if (tasks.empty()) {
-        std::cout << "No tasks to display.\n";
-        return; // Exit the function early.
+// display tasks function, the filter picks all, completed or incomplete ones.
+// Returns false when there was nothing to show. With all tasks, line k shows
+// number k, so shown[k - 1] is the id of the task the user sees as k.
+bool viewTasks(TaskClient& client, TaskFilter filter, std::vector<uint32_t>* shown, uint32_t* generation) {
+    Response response = sendRequest(client, OP_LIST, std::string(1, static_cast<char>(filter)));
+    std::cout << response.text;
+    if (shown != nullptr) {
+        *shown = std::move(response.ids);
     }
-
-    std::cout << "\n--- Your Tasks ---\n";
-    // A 'for' loop to iterate over each task in the vector.
-    // The 'size_t' type is an unsigned integer used for sizes and indices.
-    for (size_t i = 0; i < tasks.size(); ++i) {
-        // 'const auto& task' is a C++11 feature called a range-based for loop.
-        // It's a cleaner way to loop through a container.
-        const Task& task = tasks[i];
-        // 'i + 1' is used to show a user-friendly 1-based index.
-        std::cout << i + 1 << ". " << (task.isCompleted ? "[X] " : "[ ] ")
-        << task.description << "\n";
+    if (generation != nullptr) {
+        *generation = response.generation;
     }
+    return response.status == STATUS_OK;
 }
 
 // Function to mark a task as completed.
-void markTaskCompleted(std::vector<Task>& tasks) {
-    viewTasks(tasks); // First, show the user the list of tasks.
-
-    // Check if there are any tasks to mark.
-    if (tasks.empty()) {
+void markTaskCompleted(TaskClient& client) {
+    // First, show the user the list of tasks, stop if there are none.
+    std::vector<uint32_t> shown;
+    uint32_t generation;
+    if (!viewTasks(client, ALL_TASKS, &shown, &generation)) {
         return;
     }
 
@@ -121,22 +561,23 @@ void markTaskCompleted(std::vector<Task>& tasks) {
     std::cout << "Enter the number of the task to mark as completed: ";
     std::cin >> task_index;
 
-    // Check for valid input and prevent out-of-bounds access.
-    // 'task_index - 1' is used because vectors are 0-indexed.
-    if (task_index > 0 && task_index <= tasks.size()) {
-        tasks[task_index - 1].isCompleted = true;
-        std::cout << "Task marked as completed.\n";
+    // Send the id of the task the user saw under that number; if it was
+    // deleted meanwhile the daemon says so instead of hitting another task.
+    if (std::cin && task_index > 0 && static_cast<size_t>(task_index) <= shown.size()) {
+        std::cout << sendRequest(client, OP_COMPLETE, taskPayload(shown[task_index - 1], generation)).text;
     } else {
+        std::cin.clear();
         std::cout << "Invalid task number. Please try again.\n";
     }
     clearInputBuffer();
 }
 
 // Function to delete a task.
-void deleteTask(std::vector<Task>& tasks) {
-    viewTasks(tasks); // Show the user the list of tasks.
-
-    if (tasks.empty()) {
+void deleteTask(TaskClient& client) {
+    // Show the user the list of tasks.
+    std::vector<uint32_t> shown;
+    uint32_t generation;
+    if (!viewTasks(client, ALL_TASKS, &shown, &generation)) {
         return;
     }
 
@@ -144,47 +585,2966 @@ void deleteTask(std::vector<Task>& tasks) {
     std::cout << "Enter the number of the task to delete: ";
     std::cin >> task_index;
 
-    // Check for valid input.
-    if (task_index > 0 && task_index <= tasks.size()) {
-        // The 'erase' function removes an element at a specific position.
-        // 'tasks.begin() + (task_index - 1)' gives us an iterator to the element.
-        tasks.erase(tasks.begin() + (task_index - 1));
-        std::cout << "Task deleted successfully.\n";
+    if (std::cin && task_index > 0 && static_cast<size_t>(task_index) <= shown.size()) {
+        std::cout << sendRequest(client, OP_DELETE, taskPayload(shown[task_index - 1], generation)).text;
     } else {
+        std::cin.clear();
         std::cout << "Invalid task number. Please try again.\n";
     }
     clearInputBuffer();
 }
 
-// Helper function to clear the input buffer.
+// Function to search the task descriptions.
+// Terms are separated by spaces and all of them have to match:
+//   word    -> the task contains the word
+//   word*   -> the task contains a word starting with "word"
+//   ~text   -> the task contains "text" anywhere (substring, via trigrams)
+void searchTasks(TaskClient& client) {
+    std::string query;
+    std::cout << "Enter search terms (word, prefix*, ~substring): ";
+    std::getline(std::cin, query);
+    std::cout << sendRequest(client, OP_SEARCH, query).text;
+}
 
-void clearInputBuffer() {
-    // std::cin.ignore discards characters from the input buffer.
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+// Function to show the incomplete tasks due next, starting today.
+void viewNextDue(TaskClient& client) {
+    int count = readCount();
+    if (count > 0) {
+        std::cout << sendRequest(client, OP_NEXT_DUE, countPayload(count)).text;
+    }
+}
+
+// Function to show the incomplete tasks whose due date has passed.
+void viewOverdue(TaskClient& client) {
+    std::cout << sendRequest(client, OP_OVERDUE, "").text;
+}
+
+// Function to show the most urgent incomplete tasks.
+void viewTopPriority(TaskClient& client) {
+    int count = readCount();
+    if (count > 0) {
+        std::cout << sendRequest(client, OP_TOP_PRIORITY, countPayload(count)).text;
+    }
+}
+
+// Function to show every task carrying all the given tags, completed ones included.
+void viewTagged(TaskClient& client) {
+    std::string tag;
+    std::cout << "Enter the tags (separated by commas): ";
+    std::getline(std::cin, tag);
+    std::cout << sendRequest(client, OP_TAGGED, tag).text;
+}
+
+// ask for a file name and make it absolute, the daemon may run elsewhere
+static std::string readPath(const char* prompt) {
+    std::string path;
+    std::cout << prompt;
+    std::getline(std::cin, path);
+    if (!path.empty() && path[0] != '/') {
+        char cwd[4096];
+        if (getcwd(cwd, sizeof(cwd)) != nullptr) {
+            path = std::string(cwd) + "/" + path;
+        }
+    }
+    return path;
+}
+
+// Function to load many tasks at once. The format follows the extension.
+void importFile(TaskClient& client) {
+    std::string path = readPath("File to import (.csv or .jsonl): ");
+    if (!path.empty()) {
+        std::cout << sendRequest(client, OP_IMPORT, path).text;
+    }
+}
+
+// Function to save every task to a file. The format follows the extension.
+void exportFile(TaskClient& client) {
+    std::string path = readPath("File to export to (.csv or .jsonl): ");
+    if (!path.empty()) {
+        std::cout << sendRequest(client, OP_EXPORT, path).text;
+    }
+}
+
+// --- requests ---
+// Everything below runs where the tasks live: in the daemon, or in this
+// process when there is no daemon. Each handler takes the database lock
+// itself, shared for queries and exclusive for changes.
+
+// read a fixed size number off the front of a payload
+template <typename T>
+static bool takeNumber(std::string_view& payload, T& value) {
+    if (payload.size() < sizeof(T)) return false;
+    std::memcpy(&value, payload.data(), sizeof(T));
+    payload.remove_prefix(sizeof(T));
+    return true;
+}
+
+// append one task line as "3. [ ] text (p2, due 2026-10-21, #home)"
+void formatTask(std::string& out, const TaskStore& store, uint32_t id, size_t number) {
+    out += std::to_string(number);
+    out += isTaskCompleted(store, id) ? ". [X] " : ". [ ] ";
+    out += taskDescription(store, id);
+
+    std::string extra;
+    if (store.taskPriority[id] != NO_PRIORITY) {
+        extra += "p" + std::to_string(store.taskPriority[id]);
+    }
+    if (store.taskDue[id] != NO_DUE_DATE) {
+        extra += (extra.empty() ? "" : ", ") + std::string("due ") + formatDate(store.taskDue[id]);
+    }
+    std::string_view tags = textOf(store, store.taskTags[id]);
+    while (!tags.empty()) {
+        size_t comma = std::min(tags.find(','), tags.size());
+        extra += (extra.empty() ? "#" : ", #") + std::string(tags.substr(0, comma));
+        tags.remove_prefix(std::min(comma + 1, tags.size()));
+    }
+    if (!extra.empty()) {
+        out += " (" + extra + ")";
+    }
+    out += "\n";
+}
+
+// a titled list of tasks, or the empty message when there are none
+static Response taskListResponse(const TaskStore& store, const std::vector<uint32_t>& ids,
+                                 const char* title, const char* emptyMessage) {
+    if (ids.empty()) {
+        return {STATUS_EMPTY, emptyMessage};
+    }
+    std::string out = std::string("\n--- ") + title + " ---\n";
+    for (uint32_t id : ids) {
+        formatTask(out, store, id, positionOfTask(store, id));
+    }
+    return {STATUS_OK, out, ids, store.generation};
+}
+
+// the body of viewTasks
+static Response listTasks(const TaskStore& store, TaskFilter filter) {
+    // Check if there is anything to show, counting is just a popcount.
+    size_t matching = countTasks(store, filter);
+    if (matching == 0) {
+        return {STATUS_EMPTY, "No tasks to display.\n"};
+    }
+
+    std::string out = "\n--- Your Tasks (" + std::to_string(matching) + " of " + std::to_string(store.liveCount) + ") ---\n";
+    std::vector<uint32_t> ids;
+    ids.reserve(matching);
+    // Walk the bitsets one 64 bit word at a time. 'live' has a bit for every
+    // task that still exists; the filter masks it with the completed bits.
+    size_t position = 0; // number of live tasks before the current word
+    for (size_t w = 0; w < store.liveBits.size(); ++w) {
+        uint64_t live = store.liveBits[w];
+        uint64_t bits = live;
+        if (filter == COMPLETED_TASKS) bits &= store.completedBits[w];
+        if (filter == INCOMPLETE_TASKS) bits &= ~store.completedBits[w];
+        while (bits) {
+            int b = __builtin_ctzll(bits); // lowest set bit = next task
+            bits &= bits - 1;
+            uint32_t id = static_cast<uint32_t>(w * 64 + b);
+            // the number the user sees is the task's 1-based position among
+            // all live tasks, i.e. the live tasks below it plus one
+            size_t number = position + __builtin_popcountll(live & ((uint64_t(1) << b) - 1)) + 1;
+            formatTask(out, store, id, number);
+            ids.push_back(id);
+        }
+        position += __builtin_popcountll(live);
+    }
+    return {STATUS_OK, out, std::move(ids), store.generation};
+}
+
+// The changes a request can make, shared with replaying the autosave log.
+// The caller holds the database lock exclusively.
+uint32_t insertTask(TaskDatabase& db, int8_t priority, int32_t due, const std::string& tags, std::string_view description) {
+    //store the new task, it starts out not completed
+    uint32_t id = storeAddTask(db.store, description);
+    storeSetSchedule(db.store, id, priority, due, tags);
+    indexTask(db.search, id, description); //make it searchable right away
+    scheduleTask(db.schedule, db.store, id);
+    return id;
+}
+
+void completeTask(TaskDatabase& db, uint32_t id) {
+    // done tasks leave the due & priority indexes
+    unscheduleTask(db.schedule, db.store, id);
+    storeMarkCompleted(db.store, id);
+}
+
+void removeTask(TaskDatabase& db, uint32_t id) {
+    // the word, trigram & tag lists keep the id until the next compaction
+    if (!isTaskCompleted(db.store, id)) {
+        unscheduleTask(db.schedule, db.store, id);
+    }
+    storeRemoveTask(db.store, id);
+}
+
+// Run one request against the database. The payload has already been cut
+// out of its frame; anything malformed gets STATUS_INVALID back.
+Response handleRequest(TaskDatabase& db, uint8_t op, std::string_view payload) {
+    const Response malformed = {STATUS_INVALID, "Malformed request.\n"};
+    const Response badNumber = {STATUS_INVALID, "Invalid task number. Please try again.\n"};
+    const Response notSaved = {STATUS_INVALID, "Saving changes failed, so nothing can be changed until restart.\n"};
+    const Response renumbered = {STATUS_INVALID, "The task list was tidied up since it was shown, please try again.\n"};
+    db.requests.fetch_add(1, std::memory_order_relaxed);
+
+    switch (op) {
+        case OP_ADD: {
+            int8_t priority;
+            int32_t due;
+            uint32_t tagBytes;
+            if (!takeNumber(payload, priority) || !takeNumber(payload, due) ||
+                !takeNumber(payload, tagBytes) || tagBytes > payload.size()) {
+                return malformed;
+            }
+            if (priority < NO_PRIORITY || priority > 9) priority = NO_PRIORITY;
+            std::string tags = normalizeTags(std::string(payload.substr(0, tagBytes)));
+            std::string_view description = payload.substr(tagBytes);
+
+            std::unique_lock<std::shared_mutex> guard(db.lock);
+            if (savingFailed(db)) return notSaved;
+            insertTask(db, priority, due, tags, description);
+            if (db.journal) {
+                journalRecord(db, LOG_ADD, '\0' + addPayload(priority, due, tags, std::string(description)));
+            }
+            return {STATUS_OK, "Task successfully added!\n"};
+        }
+        case OP_LIST: {
+            uint8_t filter;
+            if (!takeNumber(payload, filter) || filter > INCOMPLETE_TASKS) return malformed;
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            return listTasks(db.store, static_cast<TaskFilter>(filter));
+        }
+        case OP_COMPLETE: {
+            uint32_t id, generation;
+            if (!takeNumber(payload, id) || !takeNumber(payload, generation)) return malformed;
+            std::unique_lock<std::shared_mutex> guard(db.lock);
+            if (savingFailed(db)) return notSaved;
+            if (generation != db.store.generation) return renumbered;
+            // the task may have been deleted by someone else since it was listed
+            if (!isTaskLive(db.store, id)) return badNumber;
+            if (!isTaskCompleted(db.store, id)) {
+                completeTask(db, id);
+                journalRecord(db, LOG_COMPLETE, std::string_view(reinterpret_cast<const char*>(&id), sizeof(id)));
+            }
+            return {STATUS_OK, "Task marked as completed.\n"};
+        }
+        case OP_DELETE: {
+            uint32_t id, generation;
+            if (!takeNumber(payload, id) || !takeNumber(payload, generation)) return malformed;
+            std::unique_lock<std::shared_mutex> guard(db.lock);
+            if (savingFailed(db)) return notSaved;
+            if (generation != db.store.generation) return renumbered;
+            if (!isTaskLive(db.store, id)) return badNumber;
+            removeTask(db, id);
+            journalRecord(db, LOG_DELETE, std::string_view(reinterpret_cast<const char*>(&id), sizeof(id)));
+            return {STATUS_OK, "Task deleted successfully.\n"};
+        }
+        case OP_SEARCH: {
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            auto start = std::chrono::steady_clock::now();
+            std::vector<unsigned> ids = runQuery(db.store, db.search, std::string(payload));
+            auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start);
+
+            Response response = taskListResponse(db.store, ids, "Matching Tasks", "No matching tasks.\n");
+            response.text += std::to_string(ids.size()) + " match(es) in " + std::to_string(elapsed.count()) + " us\n";
+            return response;
+        }
+        case OP_NEXT_DUE: {
+            uint32_t count;
+            if (!takeNumber(payload, count)) return malformed;
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            return taskListResponse(db.store, nextDue(db.schedule, today(), count), "Next Due", "Nothing is due.\n");
+        }
+        case OP_OVERDUE: {
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            return taskListResponse(db.store, overdue(db.schedule, today()), "Overdue", "No overdue tasks.\n");
+        }
+        case OP_TOP_PRIORITY: {
+            uint32_t count;
+            if (!takeNumber(payload, count)) return malformed;
+            // exclusive: reading the heap pops & pushes entries
+            std::unique_lock<std::shared_mutex> guard(db.lock);
+            return taskListResponse(db.store, topPriority(db.schedule, db.store, count), "Top Priority",
+                                    "No incomplete tasks have a priority.\n");
+        }
+        case OP_TAGGED: {
+            // byTag is keyed by single tags, "home,work" means tasks with both
+            std::string tags = normalizeTags(std::string(payload));
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            std::vector<uint32_t> ids;
+            bool first = true;
+            forEachTag(tags, [&](const std::string& tag) {
+                auto it = db.schedule.byTag.find(tag);
+                if (it == db.schedule.byTag.end()) {
+                    ids.clear();
+                } else if (first) {
+                    ids.assign(it->second.begin(), it->second.end());
+                } else {
+                    std::vector<uint32_t> both;
+                    std::set_intersection(ids.begin(), ids.end(), it->second.begin(), it->second.end(),
+                                          std::back_inserter(both));
+                    ids.swap(both);
+                }
+                first = false;
+            });
+            dropDeleted(db.store, ids);
+            if (ids.empty()) {
+                return {STATUS_EMPTY, "No tasks with that tag.\n"};
+            }
+            return taskListResponse(db.store, ids, ("Tagged " + tags).c_str(), "No tasks with that tag.\n");
+        }
+        case OP_COUNT: {
+            std::shared_lock<std::shared_mutex> guard(db.lock);
+            return {STATUS_OK, std::to_string(db.store.liveCount) + " tasks, " +
+                               std::to_string(countTasks(db.store, COMPLETED_TASKS)) + " completed, " +
+                               std::to_string(countTasks(db.store, INCOMPLETE_TASKS)) + " incomplete\n"};
+        }
+        case OP_IMPORT:
+            // parses without the lock, only the merge at the end is exclusive
+            return importTasks(db, std::string(payload));
+        case OP_EXPORT:
+            return exportTasks(db, std::string(payload));
+    }
+    return malformed;
+}
+
+// --- task storage ---
+
+// FNV-1a, small and good enough for interning descriptions
+static uint32_t hashText(std::string_view text) {
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+// the bytes of interned text number 'text'
+static std::string_view textOf(const TaskStore& store, uint32_t text) {
+    return std::string_view(store.arena.data() + store.textStart[text],
+                            store.textStart[text + 1] - store.textStart[text]);
+}
+
+// put a text number into the first free slot of its probe sequence
+static void internSlot(TaskStore& store, uint32_t text) {
+    size_t mask = store.internTable.size() - 1;
+    size_t slot = hashText(textOf(store, text)) & mask;
+    while (store.internTable[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    store.internTable[slot] = text + 1;
+}
+
+// Return the number of this text in the arena, storing it only if it is new.
+// The table is kept at most half full so probe sequences stay short.
+static uint32_t internText(TaskStore& store, std::string_view text) {
+    size_t texts = store.textStart.size() - 1;
+    if ((texts + 1) * 2 > store.internTable.size()) {
+        store.internTable.assign(std::max<size_t>(1024, store.internTable.size() * 2), 0);
+        for (uint32_t t = 0; t < texts; ++t) {
+            internSlot(store, t);
+        }
+    }
+
+    size_t mask = store.internTable.size() - 1;
+    size_t slot = hashText(text) & mask;
+    while (store.internTable[slot] != 0) {
+        uint32_t existing = store.internTable[slot] - 1;
+        if (textOf(store, existing) == text) {
+            return existing; // seen before, share the bytes
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t text_number = static_cast<uint32_t>(texts);
+    store.arena.insert(store.arena.end(), text.begin(), text.end());
+    store.textStart.push_back(store.arena.size());
+    store.internTable[slot] = text_number + 1;
+    return text_number;
+}
+
+// The task numbers the user sees are positions among the live tasks, so
+// going between numbers and ids needs the live tasks before a word. A
+// Fenwick tree over the per-word counts answers that, and changes with a
+// task, in O(log n) instead of a popcount over every word before it.
+// liveTree[i] holds the live tasks of words i + 1 - lowbit(i + 1) .. i.
+
+// live tasks in the words before word w
+static size_t liveBefore(const TaskStore& store, size_t w) {
+    size_t count = 0;
+    for (; w > 0; w &= w - 1) {
+        count += store.liveTree[w - 1];
+    }
+    return count;
+}
+
+static void addLive(TaskStore& store, size_t w, int delta) {
+    for (size_t i = w + 1; i <= store.liveTree.size(); i += i & (~i + 1)) {
+        store.liveTree[i - 1] += delta;
+    }
+}
+
+// add a task that is not completed yet and return its id
+uint32_t storeAddTask(TaskStore& store, std::string_view description) {
+    uint32_t id = static_cast<uint32_t>(store.taskText.size());
+    store.taskText.push_back(internText(store, description));
+    store.taskPriority.push_back(NO_PRIORITY);
+    store.taskDue.push_back(NO_DUE_DATE);
+    store.taskTags.push_back(internText(store, ""));
+    if (id % 64 == 0) {
+        // first task of a new 64 task word, its tree entry starts out with
+        // the words it covers, which are all before it
+        size_t i = store.liveTree.size() + 1;
+        store.liveTree.push_back(static_cast<uint32_t>(liveBefore(store, i - 1) - liveBefore(store, i - (i & (~i + 1)))));
+        store.liveBits.push_back(0);
+        store.completedBits.push_back(0);
+    }
+    store.liveBits[id / 64] |= uint64_t(1) << (id % 64);
+    addLive(store, id / 64, 1);
+    store.liveCount++;
+    return id;
+}
+
+// set the optional fields of a task, tags must already be normalized
+void storeSetSchedule(TaskStore& store, uint32_t id, int8_t priority, int32_t due, std::string_view tags) {
+    store.taskPriority[id] = priority;
+    store.taskDue[id] = due;
+    store.taskTags[id] = internText(store, tags);
+}
+
+void storeMarkCompleted(TaskStore& store, uint32_t id) {
+    store.completedBits[id / 64] |= uint64_t(1) << (id % 64);
+}
+
+// The slot is only marked dead. Its text stays in the arena because another
+// task may share it; compaction later drops both once nothing uses them.
+void storeRemoveTask(TaskStore& store, uint32_t id) {
+    store.liveBits[id / 64] &= ~(uint64_t(1) << (id % 64));
+    store.completedBits[id / 64] &= ~(uint64_t(1) << (id % 64));
+    addLive(store, id / 64, -1);
+    store.liveCount--;
+}
+
+std::string_view taskDescription(const TaskStore& store, uint32_t id) {
+    return textOf(store, store.taskText[id]);
+}
+
+bool isTaskCompleted(const TaskStore& store, uint32_t id) {
+    return (store.completedBits[id / 64] >> (id % 64)) & 1;
+}
+
+// true if 'id' was handed out and the task has not been deleted since
+bool isTaskLive(const TaskStore& store, uint32_t id) {
+    return id < store.taskText.size() && ((store.liveBits[id / 64] >> (id % 64)) & 1);
+}
+
+// count the tasks matching a filter, 64 tasks per popcount
+size_t countTasks(const TaskStore& store, TaskFilter filter) {
+    if (filter == ALL_TASKS) {
+        return store.liveCount;
+    }
+    const uint64_t* live = store.liveBits.data();
+    const uint64_t* done = store.completedBits.data();
+    // flip = all ones turns "completed" into "not completed"
+    uint64_t flip = filter == INCOMPLETE_TASKS ? ~uint64_t(0) : 0;
+    size_t count = 0;
+    for (size_t w = 0; w < store.liveBits.size(); ++w) {
+        count += __builtin_popcountll(live[w] & (done[w] ^ flip));
+    }
+    return count;
+}
+
+// id of the task shown as number 'position' (1-based), NO_TASK if there is none
+uint32_t taskAtPosition(const TaskStore& store, size_t position) {
+    if (position == 0 || position > store.liveCount) return NO_TASK;
+    // walk down the tree to the last word with fewer live tasks before it
+    // than 'position'; our task is in the word after it
+    size_t w = 0;
+    size_t remaining = position;
+    size_t step = 1;
+    while (step * 2 <= store.liveTree.size()) step *= 2;
+    for (; step > 0; step /= 2) {
+        if (w + step <= store.liveTree.size() && store.liveTree[w + step - 1] < remaining) {
+            w += step;
+            remaining -= store.liveTree[w - 1];
+        }
+    }
+    // drop the lowest set bits until ours is the lowest one
+    uint64_t live = store.liveBits[w];
+    for (size_t i = 1; i < remaining; ++i) {
+        live &= live - 1;
+    }
+    return static_cast<uint32_t>(w * 64 + __builtin_ctzll(live));
+}
+
+// the 1-based number viewTasks shows for a live task
+size_t positionOfTask(const TaskStore& store, uint32_t id) {
+    return liveBefore(store, id / 64) + 1 +
+           __builtin_popcountll(store.liveBits[id / 64] & ((uint64_t(1) << (id % 64)) - 1));
+}
+
+// bytes held by the store, counting spare vector capacity too
+size_t storeMemoryBytes(const TaskStore& store) {
+    return sizeof(store)
+        + store.arena.capacity()
+        + store.textStart.capacity() * sizeof(uint64_t)
+        + store.internTable.capacity() * sizeof(uint32_t)
+        + store.taskText.capacity() * sizeof(uint32_t)
+        + store.liveBits.capacity() * sizeof(uint64_t)
+        + store.liveTree.capacity() * sizeof(uint32_t)
+        + store.completedBits.capacity() * sizeof(uint64_t)
+        + store.taskPriority.capacity() * sizeof(int8_t)
+        + store.taskDue.capacity() * sizeof(int32_t)
+        + store.taskTags.capacity() * sizeof(uint32_t);
+}
+
+// --- schedule index ---
+
+// heap order: higher priority first, then the older (smaller) id
+static bool lowerPriority(const PriorityEntry& a, const PriorityEntry& b) {
+    if (a.priority != b.priority) return a.priority < b.priority;
+    return a.id > b.id;
 }
 
+// call fn(tag) for each tag in a normalized "tag1,tag2" text
+template <typename Fn>
+static void forEachTag(std::string_view tags, Fn fn) {
+    while (!tags.empty()) {
+        size_t comma = std::min(tags.find(','), tags.size());
+        fn(std::string(tags.substr(0, comma)));
+        tags.remove_prefix(std::min(comma + 1, tags.size()));
+    }
+}
+
+// add a new task to the indexes, a task that is already completed (from an
+// import) only gets its tags indexed
+void scheduleTask(ScheduleIndex& schedule, const TaskStore& store, uint32_t id) {
+    bool completed = isTaskCompleted(store, id);
+    if (!completed && store.taskDue[id] != NO_DUE_DATE) {
+        schedule.byDue.insert({store.taskDue[id], id});
+    }
+    if (!completed && store.taskPriority[id] != NO_PRIORITY) {
+        schedule.priorityHeap.push_back({store.taskPriority[id], id});
+        std::push_heap(schedule.priorityHeap.begin(), schedule.priorityHeap.end(), lowerPriority);
+    }
+    forEachTag(textOf(store, store.taskTags[id]), [&](const std::string& tag) {
+        addPosting(schedule.byTag[tag], id);
+    });
+}
 
+// Take an incomplete task out of the due & priority indexes. Tags stay, so a
+// tag still finds completed tasks.
+void unscheduleTask(ScheduleIndex& schedule, const TaskStore& store, uint32_t id) {
+    if (store.taskDue[id] != NO_DUE_DATE) {
+        schedule.byDue.erase({store.taskDue[id], id});
+    }
+    if (store.taskPriority[id] != NO_PRIORITY) {
+        // leave the heap entry in place, topPriority skips it. Once half the
+        // heap is stale it is cheaper to rebuild it than to keep skipping.
+        schedule.staleHeapEntries++;
+        if (schedule.staleHeapEntries * 2 > schedule.priorityHeap.size()) {
+            std::vector<PriorityEntry> fresh;
+            for (const PriorityEntry& entry : schedule.priorityHeap) {
+                if (entry.id != id && (store.liveBits[entry.id / 64] >> (entry.id % 64) & 1) && !isTaskCompleted(store, entry.id)) {
+                    fresh.push_back(entry);
+                }
+            }
+            std::make_heap(fresh.begin(), fresh.end(), lowerPriority);
+            schedule.priorityHeap.swap(fresh);
+            schedule.staleHeapEntries = 0;
+        }
+    }
+}
 
+// up to limit incomplete tasks due on or after fromDay, soonest first
+std::vector<uint32_t> nextDue(const ScheduleIndex& schedule, int32_t fromDay, size_t limit) {
+    std::vector<uint32_t> ids;
+    for (auto it = schedule.byDue.lower_bound({fromDay, 0}); it != schedule.byDue.end() && ids.size() < limit; ++it) {
+        ids.push_back(it->second);
+    }
+    return ids;
+}
 
+// every incomplete task due before today, oldest due date first
+std::vector<uint32_t> overdue(const ScheduleIndex& schedule, int32_t today) {
+    std::vector<uint32_t> ids;
+    for (auto it = schedule.byDue.begin(); it != schedule.byDue.end() && it->first < today; ++it) {
+        ids.push_back(it->second);
+    }
+    return ids;
+}
 
+// Up to limit incomplete tasks with the highest priority. Valid entries are
+// popped and pushed back afterwards; stale ones found on the way are dropped
+// for good, so the cost is O((limit + stale) log n).
+std::vector<uint32_t> topPriority(ScheduleIndex& schedule, const TaskStore& store, size_t limit) {
+    std::vector<PriorityEntry> taken;
+    std::vector<PriorityEntry>& heap = schedule.priorityHeap;
+    while (!heap.empty() && taken.size() < limit) {
+        std::pop_heap(heap.begin(), heap.end(), lowerPriority);
+        PriorityEntry entry = heap.back();
+        heap.pop_back();
+        bool live = store.liveBits[entry.id / 64] >> (entry.id % 64) & 1;
+        if (live && !isTaskCompleted(store, entry.id)) {
+            taken.push_back(entry);
+        } else if (schedule.staleHeapEntries > 0) {
+            schedule.staleHeapEntries--;
+        }
+    }
 
+    std::vector<uint32_t> ids;
+    for (const PriorityEntry& entry : taken) {
+        ids.push_back(entry.id);
+        heap.push_back(entry);
+        std::push_heap(heap.begin(), heap.end(), lowerPriority);
+    }
+    return ids;
+}
 
+// days since 1970-01-01 for a calendar date (Howard Hinnant's days_from_civil)
+static int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int32_t>(doe) - 719468;
+}
 
+// today's local date as days since 1970-01-01
+int32_t today() {
+    std::time_t now = std::time(nullptr);
+    std::tm local = *std::localtime(&now);
+    return daysFromCivil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+}
 
+// "YYYY-MM-DD" -> days since 1970-01-01, NO_DUE_DATE if it isn't a real date
+int32_t parseDate(std::string_view text) {
+    // three numbers separated by '-', read by hand because imports call this
+    // millions of times and sscanf would dominate their parsing time
+    int parts[3] = {0, 0, 0};
+    size_t part = 0, digits = 0;
+    for (char c : text) {
+        if (c >= '0' && c <= '9' && digits < 4) {
+            parts[part] = parts[part] * 10 + (c - '0');
+            digits++;
+        } else if (c == '-' && digits > 0 && part < 2) {
+            part++;
+            digits = 0;
+        } else {
+            return NO_DUE_DATE;
+        }
+    }
+    int y = parts[0], m = parts[1], d = parts[2];
+    if (part != 2 || digits == 0 || y < 1 || m < 1 || m > 12 || d < 1) {
+        return NO_DUE_DATE;
+    }
+    // reject days past the end of the month, e.g. 2025-02-30
+    if (d > daysFromCivil(m == 12 ? y + 1 : y, m == 12 ? 1 : m + 1, 1) - daysFromCivil(y, m, 1)) {
+        return NO_DUE_DATE;
+    }
+    return daysFromCivil(y, m, d);
+}
 
+// days since 1970-01-01 -> "YYYY-MM-DD" written to out, returns the length
+// (Howard Hinnant's civil_from_days)
+size_t formatDateTo(char* out, int32_t day) {
+    int32_t z = day + 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const int y = static_cast<int>(yoe) + era * 400 + (m <= 2);
+    return std::snprintf(out, 32, "%04d-%02u-%02u", y, m, d);
+}
 
+std::string formatDate(int32_t day) {
+    char buffer[32];
+    return std::string(buffer, formatDateTo(buffer, day));
+}
 
+// "Home, errands ,home" -> "errands,home": lowercase, trimmed, sorted, unique
+std::string normalizeTags(const std::string& text) {
+    // quick way out for text that is already in shape, e.g. from an export:
+    // lowercase, no blanks, no empty tags, sorted without duplicates
+    bool normalized = true;
+    std::string_view previous, rest = text;
+    while (normalized && !rest.empty()) {
+        std::string_view tag = rest.substr(0, rest.find(','));
+        rest.remove_prefix(std::min(rest.size(), tag.size() + 1));
+        normalized = !tag.empty() && (previous.empty() || previous < tag);
+        for (char c : tag) {
+            unsigned char u = static_cast<unsigned char>(c);
+            normalized = normalized && !std::isspace(u) && std::tolower(u) == u;
+        }
+        previous = tag;
+    }
+    if (normalized && (text.empty() || text.back() != ',')) {
+        return text;
+    }
 
+    std::vector<std::string> tags;
+    std::string tag;
+    for (size_t i = 0; i <= text.size(); ++i) {
+        char c = i < text.size() ? text[i] : ',';
+        if (c == ',') {
+            size_t first = tag.find_first_not_of(" \t");
+            size_t last = tag.find_last_not_of(" \t");
+            if (first != std::string::npos) {
+                tags.push_back(tag.substr(first, last - first + 1));
+            }
+            tag.clear();
+        } else {
+            tag += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
 
+    std::string joined;
+    for (const std::string& t : tags) {
+        joined += (joined.empty() ? "" : ",") + t;
+    }
+    return joined;
+}
 
+// --- search index ---
 
+// split text into lowercase alphanumeric words, in the order they appear
+static std::vector<std::string> splitWords(std::string_view text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (std::isalnum(uc)) {
+            word += static_cast<char>(std::tolower(uc));
+        } else if (!word.empty()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
 
+// the distinct words of a description, what gets indexed
+static std::vector<std::string> tokenize(std::string_view text) {
+    std::vector<std::string> words = splitWords(text);
+    // a word that shows up twice only gets one posting
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
 
+// every distinct trigram of the lowercased text, packed into 24 bits
+static std::vector<uint32_t> trigramsOf(std::string_view text) {
+    std::vector<uint32_t> grams;
+    for (size_t i = 0; i + 3 <= text.size(); ++i) {
+        uint32_t gram = 0;
+        for (size_t j = 0; j < 3; ++j) {
+            gram = (gram << 8) | static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(text[i + j])));
+        }
+        grams.push_back(gram);
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
 
+// ids are handed out in increasing order, so appending keeps lists sorted
+static void addPosting(std::vector<unsigned>& list, unsigned id) {
+    if (list.empty() || list.back() < id) {
+        list.push_back(id);
+    } else {
+        list.insert(std::lower_bound(list.begin(), list.end(), id), id);
+    }
+}
 
+// append a list that was built apart, with ids counted from 0, as ids from
+// first on; those are normally past every id already in the list
+static void mergePostings(std::vector<unsigned>& list, std::vector<unsigned>& staged, unsigned first) {
+    for (unsigned& id : staged) {
+        id += first;
+    }
+    if (list.empty()) {
+        list.swap(staged);
+        return;
+    }
+    size_t old = list.size();
+    list.insert(list.end(), staged.begin(), staged.end());
+    if (list[old - 1] > list[old]) {
+        std::inplace_merge(list.begin(), list.begin() + old, list.end());
+    }
+}
 
+// take the ids of deleted tasks out of a list read from the indexes
+static void dropDeleted(const TaskStore& store, std::vector<unsigned>& ids) {
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [&](unsigned id) { return !isTaskLive(store, id); }), ids.end());
+}
 
+// add the postings of one task for words & trigrams that were already worked out
+void addTokenPostings(SearchIndex& index, uint32_t id, std::string_view word) {
+    auto it = index.tokens.find(word);
+    if (it == index.tokens.end()) {
+        it = index.tokens.emplace(std::string(word), std::vector<unsigned>()).first;
+    }
+    addPosting(it->second, id);
+}
 
+void addTrigramPosting(SearchIndex& index, uint32_t id, uint32_t gram) {
+    addPosting(index.trigrams[gram], id);
+}
 
+// add one task to the index, cost is proportional to its description only
+void indexTask(SearchIndex& index, uint32_t id, std::string_view description) {
+    for (const std::string& word : tokenize(description)) {
+        addTokenPostings(index, id, word);
+    }
+    for (uint32_t gram : trigramsOf(description)) {
+        addTrigramPosting(index, id, gram);
+    }
+}
 
+// keep only the ids that are in both sorted lists
+static std::vector<unsigned> intersect(const std::vector<unsigned>& a, const std::vector<unsigned>& b) {
+    std::vector<unsigned> out;
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
 
+// ids of tasks that have a word starting with prefix
+static std::vector<unsigned> prefixMatches(const SearchIndex& index, const std::string& prefix) {
+    // gather every matching list and sort once, merging them one by one
+    // would be quadratic for short prefixes that match thousands of words
+    std::vector<unsigned> out;
+    size_t lists = 0;
+    for (auto it = index.tokens.lower_bound(prefix);
+         it != index.tokens.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+        out.insert(out.end(), it->second.begin(), it->second.end());
+        lists++;
+    }
+    if (lists > 1) {
+        std::sort(out.begin(), out.end());
+        out.erase(std::unique(out.begin(), out.end()), out.end());
+    }
+    return out;
+}
+
+// ids of tasks with all of words, the last one only as a prefix: "e-ma*"
+// needs the word "e" and a word starting with "ma"
+static std::vector<unsigned> phrasePrefixMatches(const SearchIndex& index, const std::vector<std::string>& words) {
+    if (words.empty()) return {};
+    std::vector<unsigned> matches = prefixMatches(index, words.back());
+    for (size_t i = 0; i + 1 < words.size() && !matches.empty(); ++i) {
+        auto it = index.tokens.find(words[i]);
+        if (it == index.tokens.end()) return {};
+        matches = intersect(matches, it->second);
+    }
+    return matches;
+}
+
+// ids of tasks whose description contains text (case-insensitive)
+static std::vector<unsigned> substringMatches(const TaskStore& store, const SearchIndex& index, const std::string& text) {
+    std::vector<uint32_t> grams = trigramsOf(text);
+    if (grams.empty()) {
+        // too short for a trigram, treat it as a word prefix instead
+        return phrasePrefixMatches(index, splitWords(text));
+    }
+
+    // candidates have every trigram of the text, start from the rarest list
+    std::vector<const std::vector<unsigned>*> lists;
+    for (uint32_t gram : grams) {
+        auto it = index.trigrams.find(gram);
+        if (it == index.trigrams.end()) return {};
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const std::vector<unsigned>* a, const std::vector<unsigned>* b) { return a->size() < b->size(); });
+    std::vector<unsigned> candidates = *lists[0];
+    for (size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+        candidates = intersect(candidates, *lists[i]);
+    }
+
+    // trigrams can match out of order, so check the real text of each candidate
+    std::string needle;
+    for (char c : text) needle += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    std::vector<unsigned> out;
+    for (unsigned id : candidates) {
+        if (!isTaskLive(store, id)) continue; // deleted, its text may be shared
+        std::string haystack;
+        for (char c : taskDescription(store, id)) haystack += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (haystack.find(needle) != std::string::npos) {
+            out.push_back(id);
+        }
+    }
+    return out;
+}
+
+// run a query and return the sorted ids of the tasks matching every term
+std::vector<unsigned> runQuery(const TaskStore& store, const SearchIndex& index, const std::string& query) {
+    std::vector<unsigned> result;
+    bool first = true;
+    size_t pos = 0;
+    while (pos < query.size()) {
+        // cut the next space separated term out of the query
+        size_t end = query.find(' ', pos);
+        if (end == std::string::npos) end = query.size();
+        std::string term = query.substr(pos, end - pos);
+        pos = end + 1;
+        if (term.empty()) continue;
+
+        std::vector<unsigned> matches;
+        if (term[0] == '~') {
+            matches = substringMatches(store, index, term.substr(1));
+        } else if (term.back() == '*') {
+            matches = phrasePrefixMatches(index, splitWords(term.substr(0, term.size() - 1)));
+        } else {
+            std::vector<std::string> words = tokenize(term);
+            // a term like "e-mail" becomes several words, all must match
+            for (size_t i = 0; i < words.size(); ++i) {
+                auto it = index.tokens.find(words[i]);
+                std::vector<unsigned> hits = it == index.tokens.end() ? std::vector<unsigned>() : it->second;
+                matches = i == 0 ? hits : intersect(matches, hits);
+            }
+        }
+
+        result = first ? matches : intersect(result, matches);
+        first = false;
+        if (result.empty()) break;
+    }
+    dropDeleted(store, result);
+    return result;
+}
+
+
+// --- bulk import & export ---
+// Both formats hold one task per line:
+//   CSV:        description,completed,priority,due,tags
+//               buy milk,0,3,2026-10-21,"home,errands"
+//   JSON Lines: {"description":"buy milk","completed":false,"priority":3,
+//                "due":"2026-10-21","tags":["home","errands"]}
+// Import maps the file, cuts it into chunks at line breaks and parses the
+// chunks on all cores without holding the database lock. The parsed tasks
+// are then merged under one exclusive lock, after reserving room for all of
+// them at once. Export streams the store through a fixed buffer.
+
+const char* CSV_HEADER = "description,completed,priority,due,tags";
+
+// One parsed line. Text that needed no unescaping points straight into the
+// mapped file; anything rewritten lives in the chunk's scratch buffer and
+// is found there by offset, because the buffer may move while it grows.
+struct ImportedTask {
+    const char* description;     // nullptr = use descriptionOffset in scratch
+    size_t descriptionOffset;
+    uint32_t descriptionLength;
+    size_t tagsOffset;           // normalized tags are always in scratch
+    uint32_t tagsLength;
+    int8_t priority;
+    int32_t due;
+    bool completed;
+    uint32_t wordCount;          // search words of this task in the chunk's words
+    uint32_t gramCount;          // trigrams of this task in the chunk's grams
+};
+
+// what one import thread produced for its part of the file
+struct ImportChunk {
+    const char* begin;
+    const char* end;
+    std::string scratch;
+    std::vector<ImportedTask> tasks;
+    // the search terms of every task, worked out here so the merge only has
+    // to insert postings: words separated by spaces, trigrams back to back
+    std::string words;
+    std::vector<uint32_t> grams;
+    std::string journal;         // LOG_ADD records for the autosave log, if it is on
+    size_t badLines = 0;
+};
+
+static bool parseCompleted(std::string_view field, bool& completed) {
+    if (field.empty() || field == "0" || field == "false") {
+        completed = false;
+    } else if (field == "1" || field == "true" || field == "x" || field == "X") {
+        completed = true;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parsePriority(std::string_view field, int8_t& priority) {
+    if (field.empty()) {
+        priority = NO_PRIORITY;
+    } else if (field.size() == 1 && field[0] >= '1' && field[0] <= '9') {
+        priority = static_cast<int8_t>(field[0] - '0');
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool parseDue(std::string_view field, int32_t& due) {
+    if (field.empty()) {
+        due = NO_DUE_DATE;
+        return true;
+    }
+    due = parseDate(field);
+    return due != NO_DUE_DATE;
+}
+
+// normalize tags into the chunk's scratch and remember where they went
+static void storeImportedTags(ImportChunk& chunk, ImportedTask& task, const std::string& rawTags) {
+    std::string tags = normalizeTags(rawTags);
+    task.tagsOffset = chunk.scratch.size();
+    task.tagsLength = static_cast<uint32_t>(tags.size());
+    chunk.scratch += tags;
+}
+
+// Parse one CSV line. Quoted fields may contain commas and "" for a quote.
+static bool parseCsvLine(ImportChunk& chunk, std::string_view line, ImportedTask& task) {
+    // split into at most 5 fields, unescaping quoted ones into scratch
+    std::string_view fields[5];
+    size_t fieldCount = 0;
+    std::string unescaped[5];
+    bool fromScratch[5] = {false, false, false, false, false};
+    size_t pos = 0;
+    while (true) {
+        if (fieldCount == 5) return false;
+        size_t index = fieldCount++;
+        if (pos < line.size() && line[pos] == '"') {
+            // quoted field, ends at a quote that is not doubled
+            size_t start = ++pos;
+            bool doubled = false;
+            while (true) {
+                size_t quote = line.find('"', pos);
+                if (quote == std::string_view::npos) return false;
+                if (quote + 1 < line.size() && line[quote + 1] == '"') {
+                    doubled = true;
+                    pos = quote + 2;
+                    continue;
+                }
+                pos = quote + 1;
+                break;
+            }
+            fields[index] = line.substr(start, pos - 1 - start);
+            if (doubled) {
+                for (size_t i = 0; i < fields[index].size(); ++i) {
+                    unescaped[index] += fields[index][i];
+                    if (fields[index][i] == '"') ++i; // skip the second quote
+                }
+                fromScratch[index] = true;
+            }
+            if (pos < line.size() && line[pos] != ',') return false;
+        } else {
+            size_t comma = line.find(',', pos);
+            if (comma == std::string_view::npos) comma = line.size();
+            fields[index] = line.substr(pos, comma - pos);
+            pos = comma;
+        }
+        if (pos >= line.size()) break;
+        ++pos; // skip the comma
+    }
+
+    if (!parseCompleted(fieldCount > 1 ? fields[1] : "", task.completed) ||
+        !parsePriority(fieldCount > 2 ? fields[2] : "", task.priority) ||
+        !parseDue(fieldCount > 3 ? fields[3] : "", task.due)) {
+        return false;
+    }
+    if (fromScratch[0]) {
+        task.description = nullptr;
+        task.descriptionOffset = chunk.scratch.size();
+        task.descriptionLength = static_cast<uint32_t>(unescaped[0].size());
+        chunk.scratch += unescaped[0];
+    } else {
+        task.description = fields[0].data();
+        task.descriptionLength = static_cast<uint32_t>(fields[0].size());
+    }
+    std::string tags = fieldCount > 4 ? (fromScratch[4] ? unescaped[4] : std::string(fields[4])) : "";
+    storeImportedTags(chunk, task, tags);
+    return true;
+}
+
+// --- a tiny JSON reader, just enough for one flat object per line ---
+
+static void skipSpaces(std::string_view& in) {
+    while (!in.empty() && (in[0] == ' ' || in[0] == '\t')) in.remove_prefix(1);
+}
+
+// append a code point as UTF-8
+static void appendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool readHex4(std::string_view& in, uint32_t& value) {
+    if (in.size() < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = in[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    in.remove_prefix(4);
+    return true;
+}
+
+// Read a JSON string. 'raw' gets the bytes between the quotes; only when
+// there were escapes is 'decoded' filled and 'escaped' set.
+static bool readJsonString(std::string_view& in, std::string_view& raw, std::string& decoded, bool& escaped) {
+    if (in.empty() || in[0] != '"') return false;
+    in.remove_prefix(1);
+    size_t end = 0;
+    escaped = false;
+    while (end < in.size() && in[end] != '"') {
+        if (in[end] == '\\') {
+            escaped = true;
+            ++end;
+        }
+        ++end;
+    }
+    if (end >= in.size()) return false;
+    raw = in.substr(0, end);
+    in.remove_prefix(end + 1);
+    if (!escaped) return true;
+
+    decoded.clear();
+    std::string_view rest = raw;
+    while (!rest.empty()) {
+        char c = rest[0];
+        rest.remove_prefix(1);
+        if (c != '\\') {
+            decoded += c;
+            continue;
+        }
+        if (rest.empty()) return false;
+        char e = rest[0];
+        rest.remove_prefix(1);
+        switch (e) {
+            case '"': decoded += '"'; break;
+            case '\\': decoded += '\\'; break;
+            case '/': decoded += '/'; break;
+            case 'b': decoded += '\b'; break;
+            case 'f': decoded += '\f'; break;
+            case 'n': decoded += '\n'; break;
+            case 'r': decoded += '\r'; break;
+            case 't': decoded += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!readHex4(rest, cp)) return false;
+                // a surrogate pair encodes one code point above U+FFFF
+                if (cp >= 0xD800 && cp < 0xDC00 && rest.size() >= 6 && rest[0] == '\\' && rest[1] == 'u') {
+                    rest.remove_prefix(2);
+                    uint32_t low;
+                    if (!readHex4(rest, low) || low < 0xDC00 || low > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                appendUtf8(decoded, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+// skip over any JSON value we don't care about
+static bool skipJsonValue(std::string_view& in) {
+    skipSpaces(in);
+    if (in.empty()) return false;
+    if (in[0] == '"') {
+        std::string_view raw;
+        std::string decoded;
+        bool escaped;
+        return readJsonString(in, raw, decoded, escaped);
+    }
+    if (in[0] == '{' || in[0] == '[') {
+        char close = in[0] == '{' ? '}' : ']';
+        in.remove_prefix(1);
+        skipSpaces(in);
+        if (!in.empty() && in[0] == close) {
+            in.remove_prefix(1);
+            return true;
+        }
+        while (true) {
+            if (close == '}') {
+                skipSpaces(in);
+                if (!skipJsonValue(in)) return false; // the key
+                skipSpaces(in);
+                if (in.empty() || in[0] != ':') return false;
+                in.remove_prefix(1);
+            }
+            if (!skipJsonValue(in)) return false;
+            skipSpaces(in);
+            if (in.empty()) return false;
+            if (in[0] == close) {
+                in.remove_prefix(1);
+                return true;
+            }
+            if (in[0] != ',') return false;
+            in.remove_prefix(1);
+        }
+    }
+    // number, true, false or null: everything up to the next delimiter
+    size_t end = 0;
+    while (end < in.size() && in[end] != ',' && in[end] != '}' && in[end] != ']' && in[end] != ' ') ++end;
+    if (end == 0) return false;
+    in.remove_prefix(end);
+    return true;
+}
+
+// the bare word or number at the front, e.g. true, 3 or null
+static std::string_view readJsonWord(std::string_view& in) {
+    size_t end = 0;
+    while (end < in.size() && in[end] != ',' && in[end] != '}' && in[end] != ' ') ++end;
+    std::string_view word = in.substr(0, end);
+    in.remove_prefix(end);
+    return word;
+}
+
+// Parse one JSON Lines object. Unknown keys are skipped.
+static bool parseJsonLine(ImportChunk& chunk, std::string_view line, ImportedTask& task) {
+    task.description = nullptr;
+    task.descriptionLength = 0;
+    task.completed = false;
+    task.priority = NO_PRIORITY;
+    task.due = NO_DUE_DATE;
+    bool haveDescription = false;
+    std::string tags;
+    std::string decoded;
+
+    std::string_view in = line;
+    skipSpaces(in);
+    if (in.empty() || in[0] != '{') return false;
+    in.remove_prefix(1);
+    skipSpaces(in);
+    if (!in.empty() && in[0] == '}') return false; // no description
+    while (true) {
+        std::string_view key, raw;
+        bool escaped;
+        skipSpaces(in);
+        if (!readJsonString(in, key, decoded, escaped)) return false;
+        skipSpaces(in);
+        if (in.empty() || in[0] != ':') return false;
+        in.remove_prefix(1);
+        skipSpaces(in);
+
+        if (key == "description") {
+            if (!readJsonString(in, raw, decoded, escaped)) return false;
+            if (escaped) {
+                task.description = nullptr;
+                task.descriptionOffset = chunk.scratch.size();
+                task.descriptionLength = static_cast<uint32_t>(decoded.size());
+                chunk.scratch += decoded;
+            } else {
+                task.description = raw.data();
+                task.descriptionLength = static_cast<uint32_t>(raw.size());
+            }
+            haveDescription = true;
+        } else if (key == "completed") {
+            std::string_view word = readJsonWord(in);
+            if (word != "true" && word != "false") return false;
+            task.completed = word == "true";
+        } else if (key == "priority") {
+            std::string_view word = readJsonWord(in);
+            if (word != "null" && !parsePriority(word, task.priority)) return false;
+        } else if (key == "due") {
+            if (!in.empty() && in[0] == '"') {
+                if (!readJsonString(in, raw, decoded, escaped) || !parseDue(escaped ? decoded : raw, task.due)) return false;
+            } else if (readJsonWord(in) != "null") {
+                return false;
+            }
+        } else if (key == "tags") {
+            // an array of strings, or one string of comma separated tags
+            if (!in.empty() && in[0] == '"') {
+                if (!readJsonString(in, raw, decoded, escaped)) return false;
+                tags = escaped ? decoded : std::string(raw);
+            } else {
+                if (in.empty() || in[0] != '[') return false;
+                in.remove_prefix(1);
+                skipSpaces(in);
+                while (!in.empty() && in[0] != ']') {
+                    if (!readJsonString(in, raw, decoded, escaped)) return false;
+                    tags += (tags.empty() ? "" : ",") + (escaped ? decoded : std::string(raw));
+                    skipSpaces(in);
+                    if (!in.empty() && in[0] == ',') in.remove_prefix(1);
+                    skipSpaces(in);
+                }
+                if (in.empty()) return false;
+                in.remove_prefix(1);
+            }
+        } else if (!skipJsonValue(in)) {
+            return false;
+        }
+
+        skipSpaces(in);
+        if (in.empty()) return false;
+        if (in[0] == '}') break;
+        if (in[0] != ',') return false;
+        in.remove_prefix(1);
+    }
+    if (!haveDescription) return false;
+    storeImportedTags(chunk, task, tags);
+    return true;
+}
+
+// parse every line of one chunk, runs on its own thread
+static void parseImportChunk(ImportChunk& chunk, bool json, bool journaled) {
+    const char* line = chunk.begin;
+    while (line < chunk.end) {
+        const char* newline = static_cast<const char*>(std::memchr(line, '\n', chunk.end - line));
+        const char* lineEnd = newline ? newline : chunk.end;
+        std::string_view text(line, lineEnd - line);
+        line = lineEnd + 1;
+        if (!text.empty() && text.back() == '\r') text.remove_suffix(1);
+        if (text.empty() || (!json && text == CSV_HEADER)) continue;
+
+        ImportedTask task;
+        if (json ? parseJsonLine(chunk, text, task) : parseCsvLine(chunk, text, task)) {
+            std::string_view description(task.description ? task.description : chunk.scratch.data() + task.descriptionOffset,
+                                         task.descriptionLength);
+            std::vector<std::string> words = tokenize(description);
+            std::vector<uint32_t> grams = trigramsOf(description);
+            for (const std::string& word : words) {
+                chunk.words += word;
+                chunk.words += ' ';
+            }
+            chunk.grams.insert(chunk.grams.end(), grams.begin(), grams.end());
+            task.wordCount = static_cast<uint32_t>(words.size());
+            task.gramCount = static_cast<uint32_t>(grams.size());
+            chunk.tasks.push_back(task);
+            if (journaled) {
+                std::string tags(chunk.scratch, task.tagsOffset, task.tagsLength);
+                appendLogRecord(chunk.journal, LOG_ADD, static_cast<char>(task.completed) +
+                                addPayload(task.priority, task.due, tags, std::string(description)));
+            }
+        } else {
+            chunk.badLines++;
+        }
+    }
+}
+
+// make sure 'extra' more texts fit in the intern table without rehashing
+static void reserveTexts(TaskStore& store, size_t extra) {
+    size_t texts = store.textStart.size() - 1;
+    size_t size = std::max<size_t>(1024, store.internTable.size());
+    while ((texts + extra + 1) * 2 > size) size *= 2;
+    store.textStart.reserve(texts + extra + 1);
+    if (size == store.internTable.size()) return;
+    store.internTable.assign(size, 0);
+    for (uint32_t t = 0; t < texts; ++t) {
+        internSlot(store, t);
+    }
+}
+
+// files ending in .jsonl, .ndjson or .json are JSON Lines, the rest CSV
+static bool isJsonPath(const std::string& path) {
+    for (const char* ext : {".jsonl", ".ndjson", ".json"}) {
+        size_t n = std::strlen(ext);
+        if (path.size() >= n && path.compare(path.size() - n, n, ext) == 0) return true;
+    }
+    return false;
+}
+
+// import a CSV or JSON Lines file into the database
+Response importTasks(TaskDatabase& db, const std::string& path) {
+    auto started = std::chrono::steady_clock::now();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) < 0) {
+        if (fd >= 0) close(fd);
+        return {STATUS_INVALID, "Could not open " + path + ": " + std::strerror(errno) + "\n"};
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        close(fd);
+        return {STATUS_EMPTY, "Nothing to import, " + path + " is empty.\n"};
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return {STATUS_INVALID, "Could not map " + path + ": " + std::strerror(errno) + "\n"};
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    const char* data = static_cast<const char*>(mapped);
+    bool json = isJsonPath(path);
+
+    // one chunk per core, but no chunk smaller than 4 MB, each ending on a line break
+    const size_t minChunk = 4u << 20;
+    size_t threads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), size / minChunk));
+    std::vector<ImportChunk> chunks(threads);
+    const char* begin = data;
+    for (size_t i = 0; i < threads; ++i) {
+        const char* end = data + size;
+        if (i + 1 < threads) {
+            const char* guess = std::max(begin, data + size / threads * (i + 1));
+            const char* newline = static_cast<const char*>(std::memchr(guess, '\n', data + size - guess));
+            end = newline ? newline + 1 : data + size;
+        }
+        chunks[i].begin = begin;
+        chunks[i].end = end;
+        begin = end;
+    }
+
+    // whether the log is on can't change while we parse, only the daemon's
+    // startup & shutdown set it
+    bool journaled = db.journal != nullptr;
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(parseImportChunk, std::ref(chunks[i]), json, journaled);
+    }
+    parseImportChunk(chunks[0], json, journaled);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    auto parsed = std::chrono::steady_clock::now();
+
+    size_t total = 0, textBytes = 0, badLines = 0;
+    for (const ImportChunk& chunk : chunks) {
+        total += chunk.tasks.size();
+        badLines += chunk.badLines;
+        for (const ImportedTask& task : chunk.tasks) {
+            textBytes += task.descriptionLength + task.tagsLength;
+        }
+    }
+
+    // The postings are built here, without the lock, numbering the imported
+    // tasks from 0: the word and trigram postings don't share anything, so
+    // two threads fill them at once. Under the lock each list only has to be
+    // shifted to the real ids & appended, once per distinct word or trigram.
+    SearchIndex staged;
+    std::thread wordThread([&]() {
+        uint32_t k = 0;
+        for (const ImportChunk& chunk : chunks) {
+            std::string_view words = chunk.words;
+            for (const ImportedTask& task : chunk.tasks) {
+                for (uint32_t i = 0; i < task.wordCount; ++i) {
+                    size_t space = words.find(' ');
+                    addTokenPostings(staged, k, words.substr(0, space));
+                    words.remove_prefix(space + 1);
+                }
+                k++;
+            }
+        }
+    });
+    std::thread gramThread([&]() {
+        uint32_t k = 0;
+        for (const ImportChunk& chunk : chunks) {
+            const uint32_t* gram = chunk.grams.data();
+            for (const ImportedTask& task : chunk.tasks) {
+                for (uint32_t i = 0; i < task.gramCount; ++i) {
+                    addTrigramPosting(staged, k, *gram++);
+                }
+                k++;
+            }
+        }
+    });
+    wordThread.join();
+    gramThread.join();
+    auto indexed = std::chrono::steady_clock::now();
+
+    size_t lastTicket = 0;
+    bool queued = false;
+    std::chrono::steady_clock::time_point locked, unlocked;
+    {
+        std::unique_lock<std::shared_mutex> guard(db.lock);
+        locked = std::chrono::steady_clock::now();
+        if (savingFailed(db)) {
+            munmap(mapped, size);
+            return {STATUS_INVALID, "Saving changes failed, so nothing can be imported until restart.\n"};
+        }
+        TaskStore& store = db.store;
+        uint32_t firstId = static_cast<uint32_t>(store.taskText.size());
+        // one reservation for everything that is about to be appended
+        size_t tasks = store.taskText.size() + total;
+        store.taskText.reserve(tasks);
+        store.taskPriority.reserve(tasks);
+        store.taskDue.reserve(tasks);
+        store.taskTags.reserve(tasks);
+        store.liveBits.reserve(tasks / 64 + 1);
+        store.liveTree.reserve(tasks / 64 + 1);
+        store.completedBits.reserve(tasks / 64 + 1);
+        store.arena.reserve(store.arena.size() + textBytes);
+        reserveTexts(store, 2 * total);
+
+        // Ids are handed out in order, so the k-th imported task gets
+        // firstId + k while the store is filled next to the two merges.
+        std::thread wordMerge([&]() {
+            for (auto& [word, ids] : staged.tokens) {
+                auto it = db.search.tokens.lower_bound(word);
+                if (it == db.search.tokens.end() || it->first != word) {
+                    it = db.search.tokens.emplace_hint(it, word, std::vector<unsigned>());
+                }
+                mergePostings(it->second, ids, firstId);
+            }
+        });
+        std::thread gramMerge([&]() {
+            for (auto& [gram, ids] : staged.trigrams) {
+                mergePostings(db.search.trigrams[gram], ids, firstId);
+            }
+        });
+
+        for (const ImportChunk& chunk : chunks) {
+            for (const ImportedTask& task : chunk.tasks) {
+                std::string_view description(task.description ? task.description : chunk.scratch.data() + task.descriptionOffset,
+                                             task.descriptionLength);
+                std::string_view tags(chunk.scratch.data() + task.tagsOffset, task.tagsLength);
+                uint32_t id = storeAddTask(store, description);
+                storeSetSchedule(store, id, task.priority, task.due, tags);
+                if (task.completed) {
+                    storeMarkCompleted(store, id);
+                }
+                scheduleTask(db.schedule, store, id);
+            }
+        }
+        wordMerge.join();
+        gramMerge.join();
+
+        // one autosave entry per chunk, still under the lock so the log
+        // keeps the same order as the ids
+        for (ImportChunk& chunk : chunks) {
+            if (!chunk.journal.empty()) {
+                lastTicket = autosaveQueue(*db.journal, std::move(chunk.journal));
+                queued = true;
+            }
+        }
+        unlocked = std::chrono::steady_clock::now();
+    }
+    munmap(mapped, size);
+    // a whole import is too much to lose quietly, so it answers only once saved
+    if (queued && !autosaveWait(*db.journal, lastTicket)) {
+        return {STATUS_INVALID, "Imported " + std::to_string(total) +
+                                " tasks, but saving them failed; they are gone after a restart.\n"};
+    }
+
+    auto finished = std::chrono::steady_clock::now();
+    double parseSeconds = std::chrono::duration<double>(parsed - started).count();
+    double indexSeconds = std::chrono::duration<double>(indexed - parsed).count();
+    double lockedSeconds = std::chrono::duration<double>(unlocked - locked).count();
+    double totalSeconds = std::chrono::duration<double>(finished - started).count();
+    char summary[320];
+    std::snprintf(summary, sizeof(summary),
+        "Imported %zu tasks (%zu bad lines skipped) from %.1f MB in %.3f s: parse %.0f MB/s on %zu thread(s), "
+        "index %.3f s, tasks locked for %.3f s, %.0f MB/s overall.\n",
+        total, badLines, size / 1e6, totalSeconds, size / 1e6 / parseSeconds, threads,
+        indexSeconds, lockedSeconds, size / 1e6 / totalSeconds);
+    return {STATUS_OK, summary};
+}
+
+// Buffered writer for export: text is copied into one fixed block that is
+// handed to write() whenever it fills up, no per-task strings are built.
+struct ExportWriter {
+    int fd;
+    char buffer[1 << 20];
+    size_t used = 0;
+    bool failed = false;
+    int error = 0; // errno of the write that failed
+};
+
+static void exportFlush(ExportWriter& out) {
+    size_t done = 0;
+    while (done < out.used && !out.failed) {
+        ssize_t n = write(out.fd, out.buffer + done, out.used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            out.failed = true;
+            out.error = n < 0 ? errno : ENOSPC;
+        } else {
+            done += n;
+        }
+    }
+    out.used = 0;
+}
+
+static void exportBytes(ExportWriter& out, const char* data, size_t size) {
+    while (size > 0) {
+        if (out.used == sizeof(out.buffer)) exportFlush(out);
+        size_t n = std::min(size, sizeof(out.buffer) - out.used);
+        std::memcpy(out.buffer + out.used, data, n);
+        out.used += n;
+        data += n;
+        size -= n;
+    }
+}
+
+static void exportChar(ExportWriter& out, char c) {
+    if (out.used == sizeof(out.buffer)) exportFlush(out);
+    out.buffer[out.used++] = c;
+}
+
+// CSV field: quoted when it has a comma or quote, line breaks become spaces
+// so every task stays on one line
+static void exportCsvField(ExportWriter& out, std::string_view text) {
+    if (text.find_first_of(",\"\r\n") == std::string_view::npos) {
+        exportBytes(out, text.data(), text.size());
+        return;
+    }
+    exportChar(out, '"');
+    for (char c : text) {
+        if (c == '"') exportChar(out, '"');
+        exportChar(out, (c == '\n' || c == '\r') ? ' ' : c);
+    }
+    exportChar(out, '"');
+}
+
+// JSON string with the required escapes
+static void exportJsonString(ExportWriter& out, std::string_view text) {
+    exportChar(out, '"');
+    size_t plain = 0; // start of the run of bytes that need no escaping
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        exportBytes(out, text.data() + plain, i - plain);
+        plain = i + 1;
+        char escape[8];
+        switch (c) {
+            case '"': exportBytes(out, "\\\"", 2); break;
+            case '\\': exportBytes(out, "\\\\", 2); break;
+            case '\n': exportBytes(out, "\\n", 2); break;
+            case '\r': exportBytes(out, "\\r", 2); break;
+            case '\t': exportBytes(out, "\\t", 2); break;
+            default:
+                std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                exportBytes(out, escape, 6);
+        }
+    }
+    exportBytes(out, text.data() + plain, text.size() - plain);
+    exportChar(out, '"');
+}
+
+// Export every task, in the order viewTasks shows them. The tasks go to a new
+// file next to path that replaces it once complete, so an existing file is
+// never truncated: a failed export leaves it as it was, and a symlink at path
+// is replaced rather than followed.
+Response exportTasks(TaskDatabase& db, const std::string& path) {
+    std::string temporary = path + ".XXXXXX";
+    int fd = mkostemp(&temporary[0], O_CLOEXEC);
+    if (fd < 0) {
+        return {STATUS_INVALID, "Could not create " + path + ": " + std::strerror(errno) + "\n"};
+    }
+    fchmod(fd, 0644);
+    bool json = isJsonPath(path);
+    std::unique_ptr<ExportWriter> out(new ExportWriter());
+    out->fd = fd;
+    auto started = std::chrono::steady_clock::now();
+    size_t exported = 0, bytes = 0;
+
+    // Writers only wait while the tasks are copied, a few memcpys; the
+    // formatting & the disk writes work on the copy. The intern table is not
+    // needed for reading, so it stays behind.
+    TaskStore store;
+    {
+        std::shared_lock<std::shared_mutex> guard(db.lock);
+        store.arena = db.store.arena;
+        store.textStart = db.store.textStart;
+        store.taskText = db.store.taskText;
+        store.liveBits = db.store.liveBits;
+        store.completedBits = db.store.completedBits;
+        store.taskPriority = db.store.taskPriority;
+        store.taskDue = db.store.taskDue;
+        store.taskTags = db.store.taskTags;
+    }
+    if (!json) {
+        exportBytes(*out, CSV_HEADER, std::strlen(CSV_HEADER));
+        exportChar(*out, '\n');
+    }
+    char number[32];
+    char date[32];
+    for (size_t w = 0; w < store.liveBits.size(); ++w) {
+        uint64_t bits = store.liveBits[w];
+        while (bits) {
+            uint32_t id = static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+            std::string_view tags = textOf(store, store.taskTags[id]);
+            int8_t priority = store.taskPriority[id];
+            int32_t due = store.taskDue[id];
+            bool completed = isTaskCompleted(store, id);
+
+            if (json) {
+                exportBytes(*out, "{\"description\":", 15);
+                exportJsonString(*out, taskDescription(store, id));
+                exportBytes(*out, completed ? ",\"completed\":true" : ",\"completed\":false", completed ? 17 : 18);
+                if (priority != NO_PRIORITY) {
+                    exportBytes(*out, number, std::snprintf(number, sizeof(number), ",\"priority\":%d", priority));
+                }
+                if (due != NO_DUE_DATE) {
+                    exportBytes(*out, ",\"due\":\"", 8);
+                    exportBytes(*out, date, formatDateTo(date, due));
+                    exportChar(*out, '"');
+                }
+                if (!tags.empty()) {
+                    exportBytes(*out, ",\"tags\":[", 9);
+                    while (!tags.empty()) {
+                        size_t comma = std::min(tags.find(','), tags.size());
+                        exportJsonString(*out, tags.substr(0, comma));
+                        tags.remove_prefix(std::min(comma + 1, tags.size()));
+                        if (!tags.empty()) exportChar(*out, ',');
+                    }
+                    exportChar(*out, ']');
+                }
+                exportBytes(*out, "}\n", 2);
+            } else {
+                exportCsvField(*out, taskDescription(store, id));
+                exportBytes(*out, completed ? ",1," : ",0,", 3);
+                if (priority != NO_PRIORITY) exportChar(*out, static_cast<char>('0' + priority));
+                exportChar(*out, ',');
+                if (due != NO_DUE_DATE) exportBytes(*out, date, formatDateTo(date, due));
+                exportChar(*out, ',');
+                exportCsvField(*out, tags);
+                exportChar(*out, '\n');
+            }
+            exported++;
+        }
+    }
+    bytes = lseek(fd, 0, SEEK_CUR) + out->used;
+    exportFlush(*out);
+    // close even after a failed write, and keep the errno of whichever failed first
+    if (close(fd) < 0 && !out->failed) {
+        out->failed = true;
+        out->error = errno;
+    }
+    if (!out->failed && rename(temporary.c_str(), path.c_str()) < 0) {
+        out->failed = true;
+        out->error = errno;
+    }
+    if (out->failed) {
+        unlink(temporary.c_str());
+        return {STATUS_INVALID, "Writing " + path + " failed: " + std::strerror(out->error) + "\n"};
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    char summary[256];
+    std::snprintf(summary, sizeof(summary), "Exported %zu tasks (%.1f MB) in %.3f s, %.0f MB/s.\n",
+                  exported, bytes / 1e6, seconds, bytes / 1e6 / seconds);
+    return {STATUS_OK, summary};
+}
+
+// --- autosave ---
+// Every change is logged as a record and the log is replayed on startup, so
+// the task list survives restarts and crashes. Writing happens on its own
+// thread: the menu and the daemon only put the record into a bounded
+// lock-free queue (Vyukov's MPSC ring) and carry on. The writer takes
+// whatever piled up while it was busy and saves it with one write() and one
+// fsync(), so under load many changes share one sync (group commit).
+// A torn record at the end of the log, from a crash in the middle of a
+// write, fails its checksum and is cut off on the next start.
+
+std::string defaultLogPath() {
+    const char* path = std::getenv("TASK_MANAGER_LOG");
+    if (path != nullptr) return path;
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/" + DEFAULT_LOG_NAME : DEFAULT_LOG_NAME;
+}
+
+void appendLogRecord(std::string& out, uint8_t type, std::string_view payload) {
+    std::string body;
+    body.reserve(1 + payload.size());
+    body += static_cast<char>(type);
+    body += payload;
+    appendU32(out, static_cast<uint32_t>(body.size()));
+    appendU32(out, hashText(body));
+    out += body;
+}
+
+// Hand encoded records to the writer, returns their ticket. A slot whose
+// sequence equals our ticket is free; if the writer has fallen a whole queue
+// behind we wait for it, which is what keeps the number of unsaved changes
+// bounded.
+size_t autosaveQueue(TaskJournal& journal, std::string records) {
+    size_t ticket = journal.tail.load(std::memory_order_relaxed);
+    JournalSlot* slot;
+    for (;;) {
+        slot = &journal.slots[ticket & (AUTOSAVE_QUEUE_SIZE - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        if (sequence == ticket) {
+            if (journal.tail.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed)) break;
+        } else if (sequence < ticket) {
+            std::this_thread::yield(); // full
+            ticket = journal.tail.load(std::memory_order_relaxed);
+        } else {
+            ticket = journal.tail.load(std::memory_order_relaxed); // someone else took it
+        }
+    }
+    slot->records = std::move(records);
+    slot->sequence.store(ticket + 1, std::memory_order_release); // now the writer's
+    return ticket;
+}
+
+// wait until the entry with this ticket is on disk, false if saving failed
+bool autosaveWait(TaskJournal& journal, size_t ticket) {
+    while (journal.saved.load(std::memory_order_acquire) <= ticket) {
+        if (journal.failed.load(std::memory_order_acquire)) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// true once the log gave up, from then on changes are refused instead of lost
+static bool savingFailed(const TaskDatabase& db) {
+    return db.journal != nullptr && db.journal->failed.load(std::memory_order_acquire);
+}
+
+// write one batch and fsync it, false (errno set) if that fails
+static bool autosaveWrite(TaskJournal& journal, const std::string& batch) {
+    size_t done = 0;
+    while (done < batch.size()) {
+        ssize_t n = write(journal.fd, batch.data() + done, batch.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return false;
+        if (n == 0) {
+            errno = ENOSPC;
+            return false;
+        }
+        done += n;
+    }
+    return fsync(journal.fd) == 0;
+}
+
+// log one change, the caller holds the database lock so the log has the
+// same order as the changes
+void journalRecord(TaskDatabase& db, uint8_t type, std::string_view payload) {
+    if (db.journal == nullptr) return;
+    std::string record;
+    appendLogRecord(record, type, payload);
+    autosaveQueue(*db.journal, std::move(record));
+}
+
+static void autosaveWriter(TaskJournal& journal) {
+    std::string batch;
+    for (;;) {
+        // stopping is read before draining, so nothing queued before it was
+        // set can be left behind
+        bool stopping = journal.stopping.load(std::memory_order_acquire);
+        size_t entries = 0;
+        batch.clear();
+        for (;;) {
+            JournalSlot& slot = journal.slots[journal.head & (AUTOSAVE_QUEUE_SIZE - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != journal.head + 1) break;
+            batch += slot.records;
+            slot.records.clear();
+            slot.sequence.store(journal.head + AUTOSAVE_QUEUE_SIZE, std::memory_order_release);
+            journal.head++;
+            entries++;
+        }
+        if (entries == 0) {
+            if (stopping) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds(AUTOSAVE_IDLE_MS));
+            continue;
+        }
+
+        if (journal.failed.load(std::memory_order_relaxed)) {
+            continue; // keep draining so nobody blocks on a full queue
+        }
+        // A failed write or fsync may have left part of the batch behind, so
+        // the log is cut back to the last saved byte before each new try;
+        // a disk that filled up or hiccuped gets a moment to recover
+        bool written = autosaveWrite(journal, batch);
+        for (int attempt = 1; !written && attempt <= AUTOSAVE_RETRIES; ++attempt) {
+            std::cerr << "Autosave to " << journal.path << " failed: " << std::strerror(errno) << ", retrying."
+                      << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(100 * attempt));
+            written = ftruncate(journal.fd, journal.savedBytes) == 0 && autosaveWrite(journal, batch);
+        }
+        if (!written) {
+            std::cerr << "Autosave to " << journal.path << " failed: " << std::strerror(errno)
+                      << ", the last " << entries << " change(s) are lost and no more are accepted." << std::endl;
+            journal.failed.store(true, std::memory_order_release);
+            continue;
+        }
+        journal.savedBytes += batch.size();
+        journal.saved.store(journal.head, std::memory_order_release);
+        journal.batches++;
+        journal.entries += entries;
+        journal.bytes += batch.size();
+    }
+}
+
+// apply one record from the log, false if it makes no sense
+static bool replayRecord(TaskDatabase& db, uint8_t type, std::string_view payload) {
+    TaskStore& store = db.store;
+    if (type == LOG_ADD) {
+        uint8_t completed;
+        int8_t priority;
+        int32_t due;
+        uint32_t tagBytes;
+        if (!takeNumber(payload, completed) || !takeNumber(payload, priority) || !takeNumber(payload, due) ||
+            !takeNumber(payload, tagBytes) || tagBytes > payload.size()) {
+            return false;
+        }
+        uint32_t id = insertTask(db, priority, due, std::string(payload.substr(0, tagBytes)), payload.substr(tagBytes));
+        if (completed) completeTask(db, id);
+        return true;
+    }
+    uint32_t id;
+    if ((type != LOG_COMPLETE && type != LOG_DELETE) || !takeNumber(payload, id) ||
+        id >= store.taskText.size() || !((store.liveBits[id / 64] >> (id % 64)) & 1)) {
+        return false;
+    }
+    if (type == LOG_DELETE) {
+        removeTask(db, id);
+    } else if (!isTaskCompleted(store, id)) {
+        completeTask(db, id);
+    }
+    return true;
+}
+
+// Load the log into db and start saving changes to it. Only one program may
+// write a log, so it is locked; nullptr (and why, in message) if that fails.
+std::unique_ptr<TaskJournal> openJournal(TaskDatabase& db, const std::string& path, std::string& message) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        message = "Could not open " + path + ": " + std::strerror(errno) + ".\n";
+        return nullptr;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        close(fd);
+        message = path + " is in use by another task manager.\n";
+        return nullptr;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    struct stat info;
+    fstat(fd, &info);
+    std::string log(static_cast<size_t>(info.st_size), '\0');
+    size_t size = 0;
+    while (size < log.size()) {
+        ssize_t n = pread(fd, &log[size], log.size() - size, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        size += n;
+    }
+
+    size_t good = 0, records = 0;
+    bool unfinished = false; // the bad bytes are a record a crash cut short
+    {
+        std::unique_lock<std::shared_mutex> guard(db.lock);
+        std::string_view rest(log.data(), size);
+        uint32_t length, checksum;
+        while (good < size) {
+            if (!takeNumber(rest, length) || !takeNumber(rest, checksum) || length > rest.size()) {
+                unfinished = true;
+                break;
+            }
+            std::string_view body = rest.substr(0, length);
+            if (length == 0 || hashText(body) != checksum ||
+                !replayRecord(db, static_cast<uint8_t>(body[0]), body.substr(1))) {
+                break;
+            }
+            rest.remove_prefix(length);
+            good = size - rest.size();
+            records++;
+        }
+        // a crash can also leave zeros where the file grew before the data landed
+        if (good < size && log.find_first_not_of('\0', good) == std::string::npos) {
+            unfinished = true;
+        }
+        if (good < size && !unfinished) {
+            // a damaged record with good ones after it: cutting the log here
+            // would throw those away, so load nothing and leave the log alone
+            db.store = TaskStore();
+            db.search = SearchIndex();
+            db.schedule = ScheduleIndex();
+        }
+    }
+    if (good < size && !unfinished) {
+        close(fd);
+        message = path + " is damaged at byte " + std::to_string(good) + " of " + std::to_string(size) +
+                  ", move it aside or repair it to start saving again.\n";
+        return nullptr;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    char summary[256];
+    std::snprintf(summary, sizeof(summary), "Loaded %zu tasks from %zu saved changes in %.3f s, saving to %s\n",
+                  db.store.liveCount, records, seconds, path.c_str());
+    message = summary;
+    if (good < size) {
+        // only the last record is bad and it runs past the end of the file:
+        // the program stopped while writing it, so it never counted
+        message += "Dropped " + std::to_string(size - good) + " bytes of unfinished changes at the end of the log.\n";
+        if (ftruncate(fd, good) < 0) {
+            message += "Could not cut them off: " + std::string(std::strerror(errno)) + "\n";
+        }
+    }
+
+    std::unique_ptr<TaskJournal> journal(new TaskJournal);
+    journal->fd = fd;
+    journal->path = path;
+    struct stat saved;
+    journal->savedBytes = fstat(fd, &saved) == 0 ? static_cast<size_t>(saved.st_size) : good;
+    journal->slots.reset(new JournalSlot[AUTOSAVE_QUEUE_SIZE]);
+    for (size_t i = 0; i < AUTOSAVE_QUEUE_SIZE; ++i) {
+        journal->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    journal->writer = std::thread(autosaveWriter, std::ref(*journal));
+    db.journal = journal.get();
+    // a log full of deleted tasks is rewritten right away, before anyone
+    // can have seen their ids
+    std::unique_lock<std::shared_mutex> guard(db.lock);
+    if (worthCompacting(db.store)) {
+        message += compactDatabase(db);
+    }
+    return journal;
+}
+
+// save whatever is still queued and stop the writer
+void closeJournal(TaskJournal& journal) {
+    journal.stopping.store(true, std::memory_order_release);
+    journal.writer.join();
+    close(journal.fd);
+    if (journal.batches > 0) {
+        std::cout << "Autosave: " << journal.entries << " change(s) in " << journal.batches << " fsync(s), "
+                  << journal.bytes << " bytes.\n";
+    }
+}
+
+// --- compaction ---
+// Deleting a task only clears its live bit, so with tasks coming and going
+// the slots, the arena, the posting lists (which keep deleted ids, see
+// SearchIndex) and the autosave log keep growing.
+// Compaction renumbers the live tasks 0..n-1 in the order they had, copies
+// only the texts they still use into a new arena, maps every index through
+// the new ids and rewrites the log as one add per task. The new ids keep the
+// old order, so sorted id lists stay sorted and the numbers the user sees
+// don't change. It runs once enough slots are dead: when a log is loaded,
+// and in the daemon once its clients have been quiet for COMPACT_IDLE_MS.
+const size_t COMPACT_MIN_DEAD = 1024;
+const int COMPACT_IDLE_MS = 1000;
+
+// at least a quarter of the slots are dead, and not just a handful
+static bool worthCompacting(const TaskStore& store) {
+    size_t dead = store.taskText.size() - store.liveCount;
+    return dead >= COMPACT_MIN_DEAD && dead * 4 >= store.taskText.size();
+}
+
+// the id live task 'id' gets: the number of live tasks before it, with
+// base[w] counting those in the words before w
+static uint32_t compactedId(const TaskStore& store, const std::vector<uint32_t>& base, uint32_t id) {
+    return base[id / 64] + __builtin_popcountll(store.liveBits[id / 64] & ((uint64_t(1) << (id % 64)) - 1));
+}
+
+// drop the deleted ids from a sorted list and renumber the others, which
+// keeps it sorted; false if nothing is left of it
+static bool compactPostings(std::vector<unsigned>& list, const TaskStore& store, const std::vector<uint32_t>& base) {
+    size_t kept = 0;
+    for (unsigned id : list) {
+        if (isTaskLive(store, id)) list[kept++] = compactedId(store, base, id);
+    }
+    list.resize(kept);
+    list.shrink_to_fit();
+    return kept > 0;
+}
+
+// compact every list of an index, dropping the ones that end up empty
+template <typename Map>
+static void compactIndex(Map& lists, const TaskStore& store, const std::vector<uint32_t>& base) {
+    for (auto it = lists.begin(); it != lists.end();) {
+        it = compactPostings(it->second, store, base) ? std::next(it) : lists.erase(it);
+    }
+}
+
+// fsync the directory of path, so a rename into it survives a crash
+static bool syncDirectoryOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    close(fd);
+    return synced;
+}
+
+// Replace the log with one LOG_ADD per live task in id order, which replays
+// to the ids compaction hands out. The caller holds the database lock, so
+// nothing new is queued; what was queued before is saved first. The new log
+// is written next to the old one and renamed over it once complete, so a
+// failure leaves the old log in use.
+static bool rewriteJournal(TaskDatabase& db) {
+    TaskJournal& journal = *db.journal;
+    size_t queued = journal.tail.load(std::memory_order_acquire);
+    if (queued > 0 && !autosaveWait(journal, queued - 1)) return false;
+
+    std::string temporary = journal.path + ".XXXXXX";
+    int fd = mkostemp(&temporary[0], O_APPEND | O_CLOEXEC);
+    if (fd < 0) {
+        std::cerr << "Could not compact " << journal.path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    fchmod(fd, 0644);
+    flock(fd, LOCK_EX | LOCK_NB); // nobody else knows the file yet
+
+    const TaskStore& store = db.store;
+    std::string batch;
+    size_t bytes = 0;
+    bool written = true;
+    for (size_t w = 0; w < store.liveBits.size() && written; ++w) {
+        for (uint64_t bits = store.liveBits[w]; bits && written; bits &= bits - 1) {
+            uint32_t id = static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits));
+            appendLogRecord(batch, LOG_ADD,
+                static_cast<char>(isTaskCompleted(store, id)) +
+                addPayload(store.taskPriority[id], store.taskDue[id], std::string(textOf(store, store.taskTags[id])),
+                           std::string(taskDescription(store, id))));
+            if (batch.size() >= (1u << 20)) {
+                written = writeAll(fd, batch.data(), batch.size());
+                bytes += batch.size();
+                batch.clear();
+            }
+        }
+    }
+    written = written && writeAll(fd, batch.data(), batch.size()) && fsync(fd) == 0 &&
+              rename(temporary.c_str(), journal.path.c_str()) == 0;
+    if (!written) {
+        std::cerr << "Could not compact " << journal.path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        unlink(temporary.c_str());
+        return false;
+    }
+    bytes += batch.size();
+    if (!syncDirectoryOf(journal.path)) {
+        std::cerr << "Could not sync the directory of " << journal.path << ": " << std::strerror(errno) << std::endl;
+    }
+    // the writer is idle until the next change, which the lock holds back
+    close(journal.fd);
+    journal.fd = fd;
+    journal.savedBytes = bytes;
+    return true;
+}
+
+// Compact db, the caller holds its lock exclusively. Returns what it did,
+// empty if it didn't: the log is rewritten first and when that fails the
+// tasks keep their ids.
+std::string compactDatabase(TaskDatabase& db) {
+    if (savingFailed(db)) return "";
+    auto started = std::chrono::steady_clock::now();
+    size_t bytesBefore = storeMemoryBytes(db.store);
+    size_t slotsBefore = db.store.taskText.size();
+    if (db.journal != nullptr && !rewriteJournal(db)) return "";
+
+    const TaskStore& store = db.store;
+    std::vector<uint32_t> base(store.liveBits.size());
+    uint32_t live = 0;
+    for (size_t w = 0; w < store.liveBits.size(); ++w) {
+        base[w] = live;
+        live += __builtin_popcountll(store.liveBits[w]);
+    }
+
+    compactIndex(db.search.tokens, store, base);
+    compactIndex(db.search.trigrams, store, base);
+    compactIndex(db.schedule.byTag, store, base);
+    // the due set only holds live tasks, deletes take theirs out
+    std::set<std::pair<int32_t, uint32_t>> byDue;
+    for (const auto& [due, id] : db.schedule.byDue) {
+        byDue.emplace_hint(byDue.end(), due, compactedId(store, base, id));
+    }
+    db.schedule.byDue.swap(byDue);
+
+    // a new store gets exactly the texts the live tasks use
+    TaskStore fresh;
+    fresh.generation = store.generation + 1;
+    fresh.taskText.reserve(live);
+    fresh.taskPriority.reserve(live);
+    fresh.taskDue.reserve(live);
+    fresh.taskTags.reserve(live);
+    fresh.liveBits.reserve(live / 64 + 1);
+    fresh.liveTree.reserve(live / 64 + 1);
+    fresh.completedBits.reserve(live / 64 + 1);
+    for (size_t w = 0; w < store.liveBits.size(); ++w) {
+        for (uint64_t bits = store.liveBits[w]; bits; bits &= bits - 1) {
+            uint32_t id = static_cast<uint32_t>(w * 64 + __builtin_ctzll(bits));
+            uint32_t moved = storeAddTask(fresh, taskDescription(store, id));
+            storeSetSchedule(fresh, moved, store.taskPriority[id], store.taskDue[id], textOf(store, store.taskTags[id]));
+            if (isTaskCompleted(store, id)) {
+                storeMarkCompleted(fresh, moved);
+            }
+        }
+    }
+    fresh.arena.shrink_to_fit();
+    fresh.textStart.shrink_to_fit();
+    db.store = std::move(fresh);
+
+    // the heap is rebuilt without its stale entries
+    db.schedule.priorityHeap.clear();
+    db.schedule.staleHeapEntries = 0;
+    for (uint32_t id = 0; id < live; ++id) {
+        if (!isTaskCompleted(db.store, id) && db.store.taskPriority[id] != NO_PRIORITY) {
+            db.schedule.priorityHeap.push_back({db.store.taskPriority[id], id});
+        }
+    }
+    std::make_heap(db.schedule.priorityHeap.begin(), db.schedule.priorityHeap.end(), lowerPriority);
+    db.schedule.priorityHeap.shrink_to_fit();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    char summary[256];
+    std::snprintf(summary, sizeof(summary),
+        "Compacted %zu deleted tasks away: store %.1f MB -> %.1f MB, %zu tasks kept, in %.3f s.\n",
+        slotsBefore - live, bytesBefore / 1e6, storeMemoryBytes(db.store) / 1e6, static_cast<size_t>(live), seconds);
+    return summary;
+}
+
+// --- daemon ---
+// Every worker thread runs its own epoll loop. The listening socket is in
+// all of them with EPOLLEXCLUSIVE, so a new client wakes one worker, which
+// accepts it and serves it from then on. Workers only meet at the database
+// lock, where queries from different workers run side by side.
+
+// set by SIGINT/SIGTERM, workers check it between epoll waits
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int) {
+    stopRequested = 1;
+}
+
+// One client connection, owned by the worker that accepted it.
+struct DaemonConnection {
+    int fd;
+    std::string in;      // bytes received but not yet a whole request
+    std::string out;     // responses not yet written
+    size_t outSent = 0;  // how much of 'out' the socket already took
+    std::thread job;     // an import or export running for this client
+    bool closing = false; // the client left while its job was running
+};
+
+// Imports and exports can take seconds, so they run on a thread of their
+// own instead of the epoll worker, which keeps serving its other clients.
+// The job leaves its response here and wakes the worker through the
+// eventfd; the client's later requests wait until it is answered.
+struct JobMailbox {
+    int wakeFd = -1;
+    std::mutex lock;
+    std::vector<std::pair<DaemonConnection*, Response>> done;
+};
+
+static bool isFileRequest(uint8_t op) {
+    return op == OP_IMPORT || op == OP_EXPORT;
+}
+
+// append a response frame, see RequestOp
+static void appendResponse(std::string& out, const Response& response) {
+    size_t idBytes = response.ids.size() * sizeof(uint32_t);
+    appendU32(out, static_cast<uint32_t>(1 + 2 * sizeof(uint32_t) + idBytes + response.text.size()));
+    out += static_cast<char>(response.status);
+    appendU32(out, response.generation);
+    appendU32(out, static_cast<uint32_t>(response.ids.size()));
+    out.append(reinterpret_cast<const char*>(response.ids.data()), idBytes);
+    out += response.text;
+}
+
+// write as much pending output as the socket takes, false if it is broken
+static bool flushConnection(DaemonConnection& conn) {
+    while (conn.outSent < conn.out.size()) {
+        ssize_t n = write(conn.fd, conn.out.data() + conn.outSent, conn.out.size() - conn.outSent);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn.outSent += n;
+    }
+    conn.out.clear();
+    conn.outSent = 0;
+    return true;
+}
+
+// answer the complete requests in 'in' until one has to wait for a file job,
+// false if the client sent garbage
+static bool answerRequests(DaemonConnection& conn, TaskDatabase& db, JobMailbox& mailbox) {
+    // a client may pipeline several requests, answer them in order
+    size_t used = 0;
+    while (!conn.job.joinable() && conn.in.size() - used >= sizeof(uint32_t)) {
+        uint32_t size;
+        std::memcpy(&size, conn.in.data() + used, sizeof(size));
+        if (size == 0 || size > MAX_REQUEST_SIZE) return false;
+        if (conn.in.size() - used - sizeof(size) < size) break; // rest is still on its way
+        std::string_view frame(conn.in.data() + used + sizeof(size), size);
+        uint8_t op = static_cast<uint8_t>(frame[0]);
+        if (isFileRequest(op)) {
+            DaemonConnection* client = &conn;
+            conn.job = std::thread([&db, &mailbox, client, op, path = std::string(frame.substr(1))]() {
+                Response response = handleRequest(db, op, path);
+                {
+                    std::lock_guard<std::mutex> hold(mailbox.lock);
+                    mailbox.done.emplace_back(client, std::move(response));
+                }
+                uint64_t one = 1;
+                write(mailbox.wakeFd, &one, sizeof(one));
+            });
+        } else {
+            appendResponse(conn.out, handleRequest(db, op, frame.substr(1)));
+        }
+        used += sizeof(size) + size;
+    }
+    conn.in.erase(0, used);
+    return true;
+}
+
+// read what arrived, answer every complete request, false to close the connection
+static bool serveConnection(DaemonConnection& conn, TaskDatabase& db, JobMailbox& mailbox) {
+    char buffer[64 * 1024];
+    bool open = true;
+    while (true) {
+        ssize_t n = read(conn.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) open = false;
+        break;
+    }
+
+    return answerRequests(conn, db, mailbox) && flushConnection(conn) && open;
+}
+
+// Only the user running the daemon may talk to it: requests read and write
+// files with the daemon's rights, so anyone else could use import and
+// export to get at that user's files. Clients check the other way round, so
+// they never hand their tasks to somebody else's daemon.
+static bool isOwnPeer(int fd) {
+    ucred peer;
+    socklen_t size = sizeof(peer);
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &size) == 0 && peer.uid == geteuid();
+}
+
+// after a change to what conn waits for: close it, or watch it for the right events
+static void rearmConnection(int epoll, DaemonConnection* conn, bool keep,
+                            std::unordered_set<DaemonConnection*>& connections) {
+    if (!keep) {
+        close(conn->fd); // also takes it out of the epoll set
+        conn->fd = -1;
+        if (conn->job.joinable()) {
+            conn->closing = true; // deleted when its job reports back
+            return;
+        }
+        connections.erase(conn);
+        delete conn;
+        return;
+    }
+    // only ask for EPOLLOUT while a response is stuck in the buffer
+    epoll_event mod = {};
+    mod.events = conn->out.empty() ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+    mod.data.ptr = conn;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, conn->fd, &mod);
+}
+
+static void daemonWorker(int listener, TaskDatabase& db) {
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event = {};
+    event.events = EPOLLIN | EPOLLEXCLUSIVE;
+    event.data.ptr = nullptr; // nullptr marks the listener
+    epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event);
+    JobMailbox mailbox;
+    mailbox.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event wake = {};
+    wake.events = EPOLLIN;
+    wake.data.ptr = &mailbox; // the mailbox marks finished file jobs
+    epoll_ctl(epoll, EPOLL_CTL_ADD, mailbox.wakeFd, &wake);
+
+    std::unordered_set<DaemonConnection*> connections;
+    std::vector<std::pair<DaemonConnection*, Response>> finished;
+    epoll_event events[64];
+    while (!stopRequested) {
+        int ready = epoll_wait(epoll, events, 64, 200);
+        bool jobsDone = false;
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.ptr == &mailbox) {
+                jobsDone = true; // handled after the batch, which may still name their clients
+                continue;
+            }
+            if (events[i].data.ptr == nullptr) {
+                // take every client that is waiting
+                int fd;
+                while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    if (!isOwnPeer(fd)) {
+                        close(fd);
+                        continue;
+                    }
+                    DaemonConnection* conn = new DaemonConnection();
+                    conn->fd = fd;
+                    epoll_event add = {};
+                    add.events = EPOLLIN;
+                    add.data.ptr = conn;
+                    epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &add);
+                    connections.insert(conn);
+                }
+                continue;
+            }
+
+            DaemonConnection* conn = static_cast<DaemonConnection*>(events[i].data.ptr);
+            bool keep = (events[i].events & EPOLLOUT) ? flushConnection(*conn) : true;
+            if (keep && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                keep = serveConnection(*conn, db, mailbox);
+            }
+            rearmConnection(epoll, conn, keep, connections);
+        }
+        if (!jobsDone) continue;
+        uint64_t count;
+        while (read(mailbox.wakeFd, &count, sizeof(count)) > 0) {
+        }
+        {
+            std::lock_guard<std::mutex> hold(mailbox.lock);
+            finished.swap(mailbox.done);
+        }
+        for (auto& [conn, response] : finished) {
+            conn->job.join();
+            if (conn->closing) {
+                connections.erase(conn);
+                delete conn;
+                continue;
+            }
+            appendResponse(conn->out, response);
+            bool keep = answerRequests(*conn, db, mailbox) && flushConnection(*conn);
+            rearmConnection(epoll, conn, keep, connections);
+        }
+        finished.clear();
+    }
+
+    // a running import still finishes, so what it took is saved whole
+    for (DaemonConnection* conn : connections) {
+        if (conn->job.joinable()) conn->job.join();
+        if (conn->fd >= 0) close(conn->fd);
+        delete conn;
+    }
+    close(mailbox.wakeFd);
+    close(epoll);
+}
+
+// the non-blocking listening socket at socketPath, -1 (and why, on stderr)
+// if it can't be set up. Whatever file was at the path is replaced.
+static int listenOn(const std::string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return -1;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(socketPath.c_str()); // left over from a daemon that did not shut down cleanly
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(listener, SOMAXCONN) < 0) {
+        std::cerr << "Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+// serve one task list on a unix domain socket until ctrl-c
+int runDaemon(const std::string& socketPath) {
+    // a daemon that answers owns the socket, only a dead one's file may go
+    int running = connectToDaemon(socketPath);
+    if (running >= 0) {
+        close(running);
+        std::cerr << "A task daemon is already listening on " << socketPath << std::endl;
+        return 1;
+    }
+
+    // a daemon that cannot save would lose every change on exit, so the
+    // log must be ours before we take any clients
+    TaskDatabase db;
+    std::string message;
+    std::unique_ptr<TaskJournal> journal = openJournal(db, defaultLogPath(), message);
+    std::cout << message;
+    if (!journal) {
+        std::cerr << "Not starting the task daemon." << std::endl;
+        return 1;
+    }
+
+    int listener = listenOn(socketPath);
+    if (listener < 0) {
+        closeJournal(*journal);
+        return 1;
+    }
+
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    std::signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill us
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Task daemon listening on " << socketPath << " with " << workers << " worker(s)" << std::endl;
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < workers; ++i) {
+        threads.emplace_back(daemonWorker, listener, std::ref(db));
+    }
+    // meanwhile this thread compacts the tasks whenever the clients have
+    // been quiet for a while, once per quiet spell
+    size_t seen = db.requests.load(std::memory_order_relaxed);
+    auto quietSince = std::chrono::steady_clock::now();
+    bool tried = false;
+    while (!stopRequested) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        size_t requests = db.requests.load(std::memory_order_relaxed);
+        if (requests != seen) {
+            seen = requests;
+            quietSince = std::chrono::steady_clock::now();
+            tried = false;
+            continue;
+        }
+        if (tried || std::chrono::steady_clock::now() - quietSince < std::chrono::milliseconds(COMPACT_IDLE_MS)) {
+            continue;
+        }
+        tried = true;
+        std::unique_lock<std::shared_mutex> guard(db.lock);
+        if (worthCompacting(db.store)) {
+            std::cout << compactDatabase(db) << std::flush;
+        }
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    close(listener);
+    unlink(socketPath.c_str());
+    closeJournal(*journal);
+    std::cout << "Task daemon stopped." << std::endl;
+    return 0;
+}
+
+// --- client ---
+
+// The directory for this user's sockets: $XDG_RUNTIME_DIR, which is private
+// to the user, or else /tmp/task-manager-<uid> made with mode 0700. Another
+// user could have made that one first, so it is only used when it is ours
+// and closed to everyone else; otherwise the path leads nowhere and the menu
+// keeps its tasks to itself.
+std::string socketDirectory() {
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime != nullptr && runtime[0] == '/') return runtime;
+    std::string dir = "/tmp/task-manager-" + std::to_string(geteuid());
+    mkdir(dir.c_str(), 0700); // fails harmlessly when it is already there
+    struct stat info;
+    if (lstat(dir.c_str(), &info) < 0 || !S_ISDIR(info.st_mode) || info.st_uid != geteuid() ||
+        (info.st_mode & 077) != 0) {
+        std::cerr << dir << " is not a private directory of yours, not using a task daemon." << std::endl;
+        return "/nonexistent";
+    }
+    return dir;
+}
+
+// connect to a running daemon of this user, -1 if there is none
+int connectToDaemon(const std::string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || !isOwnPeer(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// blocking helpers, the client side keeps its socket blocking
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// send one request and wait for its response
+Response sendRequest(TaskClient& client, uint8_t op, const std::string& payload) {
+    if (client.local != nullptr) {
+        return handleRequest(*client.local, op, payload);
+    }
+
+    std::string frame;
+    appendU32(frame, static_cast<uint32_t>(1 + payload.size()));
+    frame += static_cast<char>(op);
+    frame += payload;
+
+    uint32_t size;
+    Response response = {STATUS_INVALID, ""};
+    if (!writeAll(client.fd, frame.data(), frame.size()) ||
+        !readAll(client.fd, reinterpret_cast<char*>(&size), sizeof(size)) || size == 0) {
+        return {STATUS_INVALID, "Lost connection to the task daemon.\n"};
+    }
+    std::string body(size, '\0');
+    if (!readAll(client.fd, &body[0], size)) {
+        return {STATUS_INVALID, "Lost connection to the task daemon.\n"};
+    }
+    std::string_view rest(body);
+    rest.remove_prefix(1);
+    uint32_t count;
+    if (!takeNumber(rest, response.generation) || !takeNumber(rest, count) ||
+        count > rest.size() / sizeof(uint32_t)) {
+        return {STATUS_INVALID, "Lost connection to the task daemon.\n"};
+    }
+    response.status = static_cast<uint8_t>(body[0]);
+    response.ids.resize(count);
+    std::memcpy(response.ids.data(), rest.data(), count * sizeof(uint32_t));
+    response.text = std::string(rest.substr(count * sizeof(uint32_t)));
+    return response;
+}
+
+// --- load test ---
+// The load test starts its own daemon, with the same workers as --daemon but
+// on a private socket and without a log, so the thousands of tasks it adds
+// never end up in anyone's task list. Every client thread keeps one
+// connection and sends a read-heavy mix (9 queries to 1 add) back to back,
+// recording the latency of each request.
+
+int runLoadTest(int clients, int seconds) {
+    if (clients <= 0 || seconds <= 0) {
+        std::cerr << "Client count and seconds must be positive." << std::endl;
+        return 1;
+    }
+    std::string socketPath = socketDirectory() + "/task-manager-loadtest-" + std::to_string(getpid()) + ".sock";
+    int listener = listenOn(socketPath);
+    if (listener < 0) {
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    TaskDatabase db;
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> daemon;
+    for (unsigned i = 0; i < workers; ++i) {
+        daemon.emplace_back(daemonWorker, listener, std::ref(db));
+    }
+
+    TaskClient seeder;
+    seeder.fd = connectToDaemon(socketPath);
+
+    // make sure the queries have something to chew on
+    const char* verbs[] = {"buy", "call", "email", "fix", "review", "write", "plan", "clean"};
+    for (int i = 0; i < 10000; ++i) {
+        std::string description = std::string(verbs[i % 8]) + " item " + std::to_string(i) + " before the weekly sync";
+        sendRequest(seeder, OP_ADD, addPayload(1 + i % 9, today() + i % 60 - 10, "", description));
+    }
+    close(seeder.fd);
+
+    std::vector<std::vector<uint32_t>> latencies(clients); // nanoseconds, per client
+    std::atomic<int> failed(0);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    auto started = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            TaskClient client;
+            client.fd = connectToDaemon(socketPath);
+            if (client.fd < 0) {
+                failed++;
+                return;
+            }
+            std::vector<uint32_t>& mine = latencies[c];
+            for (unsigned i = 0; std::chrono::steady_clock::now() < deadline; ++i) {
+                uint8_t op;
+                std::string payload;
+                switch (i % 10) {
+                    case 0:
+                        op = OP_ADD;
+                        payload = addPayload(NO_PRIORITY, NO_DUE_DATE, "", "load test task");
+                        break;
+                    case 1: case 2: case 3:
+                        op = OP_SEARCH;
+                        payload = verbs[(c + i) % 8] + std::string(" item 1*");
+                        break;
+                    case 4: case 5: case 6:
+                        op = OP_COUNT;
+                        break;
+                    default:
+                        op = OP_NEXT_DUE;
+                        payload = countPayload(20);
+                        break;
+                }
+                auto sent = std::chrono::steady_clock::now();
+                Response response = sendRequest(client, op, payload);
+                if (response.status == STATUS_INVALID) {
+                    failed++;
+                    break;
+                }
+                mine.push_back(static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - sent).count()));
+            }
+            close(client.fd);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    stopRequested = 1;
+    for (std::thread& thread : daemon) {
+        thread.join();
+    }
+    close(listener);
+    unlink(socketPath.c_str());
+
+    std::vector<uint32_t> all;
+    for (const std::vector<uint32_t>& mine : latencies) {
+        all.insert(all.end(), mine.begin(), mine.end());
+    }
+    if (all.empty()) {
+        std::cerr << "No requests completed." << std::endl;
+        return 1;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))] / 1000.0; };
+
+    std::cout << clients << " clients, " << all.size() << " requests in " << elapsed << " s\n";
+    std::cout << "throughput: " << static_cast<long>(all.size() / elapsed) << " requests/s\n";
+    std::cout << "latency us: p50 " << percentile(0.50) << ", p90 " << percentile(0.90)
+              << ", p99 " << percentile(0.99) << ", max " << all.back() / 1000.0 << "\n";
+    if (failed > 0) {
+        std::cout << failed << " client(s) failed\n";
+    }
+    return failed > 0 ? 1 : 0;
+}
+
+// --- benchmark ---
+// Runs the same requests the menu sends, but straight against a database in
+// this process so nothing waits on stdin or a socket. For every list size it
+// builds the list with adds, then times views, completes and deletes, and
+// finally a random mix of everything. The workload is seeded so two runs do
+// the same work and their JSON files can be compared. Phases after the build
+// stop early once they used up their time, so 10M tasks finish too; the
+// sample counts in the results say how far each one got.
+
+const uint64_t BENCH_SEED = 20240601;
+const double BENCH_PHASE_SECONDS = 10;
+
+// latencies of one kind of request, in nanoseconds
+struct OpTimings {
+    std::vector<uint64_t> samples;
+    uint64_t outputBytes = 0;
+};
+
+static uint64_t elapsedNanos(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+}
+
+// time one request and keep the size of what it would have printed
+static Response timedRequest(TaskClient& client, OpTimings& timings, uint8_t op, const std::string& payload) {
+    auto sent = std::chrono::steady_clock::now();
+    Response response = sendRequest(client, op, payload);
+    timings.samples.push_back(elapsedNanos(sent));
+    timings.outputBytes += response.text.size();
+    return response;
+}
+
+// resident memory of this process from /proc, 0 if it can't be read
+static size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// a made up but plausible task, with a few priorities, dates and tags
+static std::string benchTask(std::mt19937_64& random) {
+    static const char* verbs[] = {"buy", "call", "email", "fix", "review", "write", "plan", "clean", "book", "update"};
+    static const char* things[] = {"report", "invoice", "car", "kitchen", "slides", "budget", "ticket", "garden",
+                                   "flight", "backup", "dentist", "release", "notes", "roof", "contract", "laptop"};
+    static const char* tags[] = {"", "", "home", "work", "errands", "work,urgent", "home,weekend"};
+    std::string description = std::string(verbs[random() % 10]) + " the " + things[random() % 16] +
+                              " #" + std::to_string(random() % 100000);
+    int8_t priority = static_cast<int8_t>(random() % 10); // 0 is no priority
+    int32_t due = random() % 3 == 0 ? NO_DUE_DATE : today() + static_cast<int32_t>(random() % 120) - 30;
+    return addPayload(priority, due, tags[random() % 7], description);
+}
+
+// {"count":..,"mean_us":..,"p50_us":..} and friends for one set of samples
+static void writeTimings(std::ostream& out, const char* name, OpTimings& timings, double seconds) {
+    std::vector<uint64_t>& all = timings.samples;
+    std::sort(all.begin(), all.end());
+    double total = 0;
+    for (uint64_t sample : all) total += sample;
+    auto percentile = [&](double p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))] / 1000.0;
+    };
+
+    out << "\"" << name << "\": {\"count\": " << all.size()
+        << ", \"mean_us\": " << (all.empty() ? 0.0 : total / all.size() / 1000.0)
+        << ", \"p50_us\": " << percentile(0.50) << ", \"p90_us\": " << percentile(0.90)
+        << ", \"p99_us\": " << percentile(0.99) << ", \"p999_us\": " << percentile(0.999)
+        << ", \"max_us\": " << (all.empty() ? 0.0 : all.back() / 1000.0)
+        << ", \"ops_per_s\": " << (seconds > 0 ? all.size() / seconds : 0.0)
+        << ", \"output_bytes\": " << timings.outputBytes
+        << ", \"output_mb_per_s\": " << (total > 0 ? timings.outputBytes / (total / 1e9) / 1e6 : 0.0) << "}";
+
+    std::cout << "  " << name << ": " << all.size() << " ops, p50 " << percentile(0.50) << " us, p99 "
+              << percentile(0.99) << " us, max " << (all.empty() ? 0.0 : all.back() / 1000.0) << " us";
+    if (timings.outputBytes > 0 && total > 0) {
+        std::cout << ", output " << timings.outputBytes / (total / 1e9) / 1e6 << " MB/s";
+    }
+    std::cout << "\n";
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+// everything measured for one list size, written as one JSON object
+static void benchmarkSize(std::ostream& out, size_t size) {
+    std::mt19937_64 random(BENCH_SEED + size);
+    std::unique_ptr<TaskDatabase> db(new TaskDatabase);
+    TaskClient client;
+    client.local = db.get();
+    size_t rssBefore = residentBytes();
+    std::cout << size << " tasks" << std::endl;
+
+    // build the list, every add is timed
+    OpTimings adds;
+    adds.samples.reserve(size);
+    auto started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < size; ++i) {
+        timedRequest(client, adds, OP_ADD, benchTask(random));
+    }
+    double buildSeconds = secondsSince(started);
+    size_t storeBytes = storeMemoryBytes(db->store);
+    size_t rssAfter = residentBytes();
+
+    // viewing is the whole list every time, so fewer rounds on big lists
+    OpTimings views;
+    size_t viewRounds = std::max<size_t>(1, std::min<size_t>(1000, 10000000 / std::max<size_t>(size, 1)));
+    started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < viewRounds && secondsSince(started) < BENCH_PHASE_SECONDS; ++i) {
+        TaskFilter filter = static_cast<TaskFilter>(i % 3);
+        timedRequest(client, views, OP_LIST, std::string(1, static_cast<char>(filter)));
+    }
+    double viewSeconds = secondsSince(started);
+
+    // completes & deletes pick random task numbers, like a user would, and
+    // send the id shown under that number, like the client does
+    size_t changes = std::min<size_t>(size / 4, 100000);
+    OpTimings completes;
+    started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < changes && secondsSince(started) < BENCH_PHASE_SECONDS; ++i) {
+        uint32_t number = static_cast<uint32_t>(1 + random() % db->store.liveCount);
+        timedRequest(client, completes, OP_COMPLETE, taskPayload(taskAtPosition(db->store, number), db->store.generation));
+    }
+    double completeSeconds = secondsSince(started);
+
+    OpTimings deletes;
+    started = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < changes && db->store.liveCount > 0 && secondsSince(started) < BENCH_PHASE_SECONDS; ++i) {
+        uint32_t number = static_cast<uint32_t>(1 + random() % db->store.liveCount);
+        timedRequest(client, deletes, OP_DELETE, taskPayload(taskAtPosition(db->store, number), db->store.generation));
+    }
+    double deleteSeconds = secondsSince(started);
+
+    // mixed workload: mostly small requests with the odd full listing. The
+    // searches look for one task's number like a user would, a search that
+    // matches a tenth of the list is really a listing.
+    static const char* verbs[] = {"buy", "call", "email", "fix", "review"};
+    OpTimings mixed[6];
+    const char* mixedNames[6] = {"add", "complete", "delete", "search", "next_due", "view"};
+    size_t mixedOps = std::max<size_t>(1000, std::min<size_t>(200000, size));
+    size_t done = 0;
+    started = std::chrono::steady_clock::now();
+    for (; done < mixedOps && secondsSince(started) < BENCH_PHASE_SECONDS; ++done) {
+        unsigned roll = random() % 1000;
+        size_t live = db->store.liveCount;
+        uint32_t number = static_cast<uint32_t>(1 + random() % std::max<size_t>(live, 1));
+        if (roll < 300 || live == 0) {
+            timedRequest(client, mixed[0], OP_ADD, benchTask(random));
+        } else if (roll < 500) {
+            timedRequest(client, mixed[1], OP_COMPLETE, taskPayload(taskAtPosition(db->store, number), db->store.generation));
+        } else if (roll < 600) {
+            timedRequest(client, mixed[2], OP_DELETE, taskPayload(taskAtPosition(db->store, number), db->store.generation));
+        } else if (roll < 800) {
+            std::string wanted = std::to_string(random() % 100000);
+            switch (random() % 3) {
+                case 0: timedRequest(client, mixed[3], OP_SEARCH, wanted); break;
+                case 1: timedRequest(client, mixed[3], OP_SEARCH, verbs[random() % 5] + (" " + wanted)); break;
+                default: timedRequest(client, mixed[3], OP_SEARCH, wanted.substr(0, 4) + "*"); break;
+            }
+        } else if (roll < 999 || live > 100000) {
+            timedRequest(client, mixed[4], OP_NEXT_DUE, countPayload(20));
+        } else {
+            // whole listings only while they stay cheap, they would swamp the rest
+            timedRequest(client, mixed[5], OP_LIST, std::string(1, static_cast<char>(INCOMPLETE_TASKS)));
+        }
+    }
+    double mixedSeconds = secondsSince(started);
+
+    std::cout << "  memory: store " << storeBytes << " bytes (" << storeBytes / std::max<double>(size, 1)
+              << " per task), resident " << rssAfter << " bytes\n";
+    out << "    {\"tasks\": " << size << ", \"build_seconds\": " << buildSeconds
+        << ",\n     \"memory\": {\"store_bytes\": " << storeBytes
+        << ", \"store_bytes_per_task\": " << storeBytes / std::max<double>(size, 1)
+        << ", \"resident_bytes\": " << rssAfter
+        << ", \"resident_growth_bytes\": " << (rssAfter > rssBefore ? rssAfter - rssBefore : 0) << "},\n     ";
+    writeTimings(out, "add", adds, buildSeconds);
+    out << ",\n     ";
+    writeTimings(out, "view", views, viewSeconds);
+    out << ",\n     ";
+    writeTimings(out, "complete", completes, completeSeconds);
+    out << ",\n     ";
+    writeTimings(out, "delete", deletes, deleteSeconds);
+    out << ",\n     \"mixed\": {\"ops\": " << done << ", \"seconds\": " << mixedSeconds
+        << ", \"ops_per_s\": " << done / mixedSeconds;
+    std::cout << "  mixed: " << static_cast<long>(done / mixedSeconds) << " ops/s\n";
+    for (int k = 0; k < 6; ++k) {
+        out << ",\n       ";
+        std::cout << "  ";
+        writeTimings(out, mixedNames[k], mixed[k], mixedSeconds);
+    }
+    out << "}}";
+}
+
+int runBenchmark(const std::string& resultPath, const std::vector<size_t>& sizes) {
+    std::ofstream out(resultPath);
+    if (!out) {
+        std::cerr << "Can't write " << resultPath << std::endl;
+        return 1;
+    }
+    out << "{\"benchmark\": \"task-manager\", \"version\": 1, \"seed\": " << BENCH_SEED
+        << ", \"timestamp\": " << std::time(nullptr)
+        << ", \"hardware_threads\": " << std::thread::hardware_concurrency()
+        << ", \"compiler\": \"" << __VERSION__ << "\",\n  \"runs\": [\n";
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        benchmarkSize(out, sizes[i]);
+        out << (i + 1 < sizes.size() ? ",\n" : "\n");
+        out.flush(); // keep what we have if a big size runs out of memory
+    }
+    out << "  ]}\n";
+    std::cout << "Results written to " << resultPath << std::endl;
+    return out ? 0 : 1;
+}
+
+// Helper function to clear the input buffer.
+
+void clearInputBuffer() {
+    // std::cin.ignore discards characters from the input buffer.
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+}
@@ -6,6 +6,13 @@
 #include <map>
 #include <tuple>
 #include <algorithm> // This header is needed for std::reverse
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 // --- Cross-platform includes for console input and sleep ---
 #ifdef _WIN32
@@ -69,8 +76,12 @@ std::vector<std::string> gameMap = {
 
 int robberX = 1;
 int robberY = 1;
-int copX = 33;
-int copY = 17;
+// A cop, and what it's standing on so that can be put back when it moves on
+struct Cop {
+    int x, y;
+    char under;
+};
+std::vector<Cop> cops = {{33, 17, EMPTY}};
 int score = 0;
 int collectiblesLeft = 32; // Updated count for the new map
 bool gameOver = false;
@@ -78,15 +89,39 @@ char currentRobberDirection = ' '; // New variable to store the robber's continu
 
 // Struct to represent a node in the pathfinding grid
 struct Node {
-    int x, y;
-    int gScore, hScore, fScore;
+    int cell; // y * gridWidth + x
+    int gScore, fScore;
 
-    // A* requires a way to compare nodes in the priority queue
+    // A* requires a way to compare nodes in the open set: lowest fScore
+    // first, and the one further from the start on ties
     bool operator>(const Node& other) const {
-        return fScore > other.fScore;
+        return fScore > other.fScore || (fScore == other.fScore && gScore < other.gScore);
     }
 };
 
+// --- Pathfinding grid and scratch space ---
+// Cells are numbered y * gridWidth + x. The walls are shared by every search,
+// the rest belongs to one search at a time: its per-cell arrays are
+// allocated once for the map and reused, a cell's gScore and cameFrom only
+// count when its stamp matches the current search, so nothing is cleared
+// between searches
+int gridWidth = 0;
+int gridHeight = 0;
+std::vector<unsigned char> wallAt; // 1 where the map has a wall
+std::vector<unsigned char> exitsAt; // open neighbours: 1 left, 2 right, 4 up, 8 down
+std::vector<unsigned long long> wallBits; // wallAt again, one bit per cell
+
+struct SearchScratch {
+    std::vector<int> gScoreAt;
+    std::vector<int> cameFromAt;
+    std::vector<unsigned> stampAt;
+    unsigned searchStamp = 0;
+    std::vector<Node> openHeap; // binary heap kept between searches for its storage
+    long long nodesExpanded = 0; // for the benchmarks
+};
+
+SearchScratch mainScratch; // for searches on the main thread
+
 // Function to move the cursor to a specific position (x, y)
 void gotoxy(int x, int y) {
 #ifdef _WIN32
@@ -155,95 +190,590 @@ void moveRobber(char move) {
     }
 }
 
-// A* pathfinding algorithm
-std::vector<std::pair<int, int>> findPath(int startX, int startY, int endX, int endY) {
-    // A* algorithm implementation
-    std::priority_queue<Node, std::vector<Node>, std::greater<Node>> openSet;
-    std::map<std::pair<int, int>, std::pair<int, int>> cameFrom;
-    std::map<std::pair<int, int>, int> gScore;
+// Work out which neighbours of a cell are open, so searches don't have to
+// check the map edges
+void updateExits(int cell) {
+    int x = cell % gridWidth;
+    int y = cell / gridWidth;
+    exitsAt[cell] = (x > 0 && !wallAt[cell - 1] ? 1 : 0) | (x < gridWidth - 1 && !wallAt[cell + 1] ? 2 : 0) |
+                    (y > 0 && !wallAt[cell - gridWidth] ? 4 : 0) |
+                    (y < gridHeight - 1 && !wallAt[cell + gridWidth] ? 8 : 0);
+}
+
+// Build the wall grid from gameMap, needed again whenever a wall changes.
+// Rows shorter than the first one are treated as walls past their end
+void buildGrid() {
+    gridHeight = gameMap.size();
+    gridWidth = 0;
+    for (const auto& row : gameMap) {
+        gridWidth = std::max(gridWidth, (int)row.size());
+    }
+    int cells = gridWidth * gridHeight;
+    wallAt.assign(cells, 1);
+    for (int y = 0; y < gridHeight; ++y) {
+        for (int x = 0; x < (int)gameMap[y].size(); ++x) {
+            wallAt[y * gridWidth + x] = gameMap[y][x] == WALL;
+        }
+    }
+    exitsAt.assign(cells, 0);
+    wallBits.assign((cells + 63) / 64, 0);
+    for (int cell = 0; cell < cells; ++cell) {
+        updateExits(cell);
+        wallBits[cell >> 6] |= (unsigned long long)wallAt[cell] << (cell & 63);
+    }
+}
+
+// A* pathfinding algorithm. Fills path with the steps from the start to the
+// end, without the start; leaves it empty when there's no way through. Any
+// number of threads can search at once, each with its own scratch, as long
+// as the grid isn't changing
+void findPath(int startX, int startY, int endX, int endY, std::vector<std::pair<int, int>>& path,
+              SearchScratch& scratch = mainScratch) {
+    path.clear();
+    if ((int)gameMap.size() != gridHeight || gridWidth == 0) {
+        buildGrid();
+    }
+    std::vector<int>& gScoreAt = scratch.gScoreAt;
+    std::vector<int>& cameFromAt = scratch.cameFromAt;
+    std::vector<unsigned>& stampAt = scratch.stampAt;
+    std::vector<Node>& openHeap = scratch.openHeap;
+    if ((int)stampAt.size() != gridWidth * gridHeight) {
+        gScoreAt.assign(gridWidth * gridHeight, 0);
+        cameFromAt.assign(gridWidth * gridHeight, -1);
+        stampAt.assign(gridWidth * gridHeight, 0);
+        scratch.searchStamp = 0;
+    }
+
+    // A new stamp makes every cell unvisited; on wrap-around the old stamps
+    // could come back, so they're wiped once every 4 billion searches
+    unsigned searchStamp = ++scratch.searchStamp;
+    if (searchStamp == 0) {
+        std::fill(stampAt.begin(), stampAt.end(), 0);
+        searchStamp = scratch.searchStamp = 1;
+    }
 
     // Heuristic function (Manhattan distance)
-    auto heuristic = [](int x1, int y1, int x2, int y2) {
-        return std::abs(x1 - x2) + std::abs(y1 - y2);
+    auto heuristic = [endX, endY](int x, int y) {
+        return std::abs(x - endX) + std::abs(y - endY);
     };
 
-    openSet.push({startX, startY, 0, heuristic(startX, startY, endX, endY), heuristic(startX, startY, endX, endY)});
-    gScore[{startX, startY}] = 0;
+    int start = startY * gridWidth + startX;
+    int end = endY * gridWidth + endX;
+    openHeap.clear();
+    openHeap.push_back({start, 0, heuristic(startX, startY)});
+    gScoreAt[start] = 0;
+    cameFromAt[start] = -1;
+    stampAt[start] = searchStamp;
 
-    while (!openSet.empty()) {
-        Node current = openSet.top();
-        openSet.pop();
+    while (!openHeap.empty()) {
+        std::pop_heap(openHeap.begin(), openHeap.end(), std::greater<Node>());
+        Node current = openHeap.back();
+        openHeap.pop_back();
 
-        if (current.x == endX && current.y == endY) {
+        // A cell can be in the heap more than once, only its best entry counts
+        if (current.gScore != gScoreAt[current.cell]) {
+            continue;
+        }
+        scratch.nodesExpanded++;
+
+        if (current.cell == end) {
             // Reconstruct path
-            std::vector<std::pair<int, int>> path;
-            std::pair<int, int> currentPos = {endX, endY};
-            while (cameFrom.count(currentPos)) {
-                path.push_back(currentPos);
-                currentPos = cameFrom[currentPos];
+            for (int cell = end; cell != start; cell = cameFromAt[cell]) {
+                path.push_back({cell % gridWidth, cell / gridWidth});
             }
             std::reverse(path.begin(), path.end());
-            return path;
+            return;
         }
 
-        // Explore neighbors (up, down, left, right)
-        int dx[] = {0, 0, 1, -1};
-        int dy[] = {1, -1, 0, 0};
+        // Explore neighbors (left, right, up, down)
+        int x = current.cell % gridWidth;
+        int y = current.cell / gridWidth;
+        int dx[] = {-1, 1, 0, 0};
+        int dy[] = {0, 0, -1, 1};
 
         for (int i = 0; i < 4; ++i) {
-            int neighborX = current.x + dx[i];
-            int neighborY = current.y + dy[i];
-
-            if (neighborX >= 0 && neighborX < gameMap[0].size() && neighborY >= 0 && neighborY < gameMap.size() && gameMap[neighborY][neighborX] != WALL) {
-                int tentativeGScore = gScore[{current.x, current.y}] + 1;
-                
-                if (tentativeGScore < gScore[{neighborX, neighborY}] || !gScore.count({neighborX, neighborY})) {
-                    cameFrom[{neighborX, neighborY}] = {current.x, current.y};
-                    gScore[{neighborX, neighborY}] = tentativeGScore;
-                    int hScore = heuristic(neighborX, neighborY, endX, endY);
-                    int fScore = tentativeGScore + hScore;
-                    openSet.push({neighborX, neighborY, tentativeGScore, hScore, fScore});
-                }
+            if (!(exitsAt[current.cell] >> i & 1)) {
+                continue;
+            }
+            int neighborX = x + dx[i];
+            int neighborY = y + dy[i];
+            int neighbor = neighborY * gridWidth + neighborX;
+
+            int tentativeGScore = current.gScore + 1;
+            if (stampAt[neighbor] != searchStamp || tentativeGScore < gScoreAt[neighbor]) {
+                stampAt[neighbor] = searchStamp;
+                gScoreAt[neighbor] = tentativeGScore;
+                cameFromAt[neighbor] = current.cell;
+                openHeap.push_back({neighbor, tentativeGScore, tentativeGScore + heuristic(neighborX, neighborY)});
+                std::push_heap(openHeap.begin(), openHeap.end(), std::greater<Node>());
             }
         }
     }
 
     // No path found
-    return {};
 }
 
-// Simple AI for the cop: chase the robber using A*
-void moveCop() {
-    // Calculate the path to the robber
-    auto path = findPath(copX, copY, robberX, robberY);
-    
-    // Move to the next tile on the path
-    if (!path.empty()) {
-        // Clear old cop position
-        gameMap[copY][copX] = EMPTY;
+// --- Incremental planner for the chasing cop ---
+// Moving Target D* Lite. The search tree is rooted at the cop and kept from
+// one move to the next instead of starting over:
+// - when the robber moves, km grows by as much as the heuristic can have
+//   dropped, so the keys already in the heap stay lower bounds
+// - when the cop steps to a cell of its own tree, only the cells that don't
+//   hang below the new cell are thrown away. The rest keep their g values,
+//   which are all off by the same amount from the new start, so they still
+//   compare right
+// - a wall that changes only re-evaluates its cell and the neighbours
+// Cells whose g and rhs differ wait in an indexed heap, so their key can be
+// changed or they can be taken out wherever they are in it
+struct PlanKey {
+    int k1, k2;
+
+    bool operator<(const PlanKey& other) const {
+        return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+    }
+};
+
+struct ChasePlanner {
+    static constexpr int INF = 1 << 29;
+
+    int width = 0;
+    int start = -1;
+    int goal = -1;
+    int goalX = 0, goalY = 0;
+    int km = 0;
+    // Everything about a cell in one place, a search touches all of it
+    struct CellState {
+        int g, rhs, parent;
+        int heapPos; // where the cell is in the heap, -1 when it isn't
+    };
+    std::vector<CellState> state;
+    std::vector<std::pair<PlanKey, int>> heap;
+    std::vector<int> deleted; // scratch for moveStart
+    long long nodesExpanded = 0;
+
+    // Throw everything away and search from scratch on the current grid
+    void reset(int startCell, int goalCell) {
+        int cells = gridWidth * gridHeight;
+        width = gridWidth;
+        state.assign(cells, {INF, INF, -1, -1});
+        heap.clear();
+        km = 0;
+        start = startCell;
+        goal = goalCell;
+        goalX = goal % width;
+        goalY = goal / width;
+        state[start].rhs = 0;
+        heapPush(start, key(start));
+    }
+
+    int heuristic(int a, int b) const {
+        return std::abs(a % width - b % width) + std::abs(a / width - b / width);
+    }
+
+    PlanKey key(int s) const {
+        int best = std::min(state[s].g, state[s].rhs);
+        if (best >= INF) {
+            return {INF, INF};
+        }
+        int h = std::abs(s % width - goalX) + std::abs(s / width - goalY);
+        return {best + h + km, best};
+    }
+
+    // Calls f on each open neighbour of a cell
+    template <typename F>
+    void forNeighbors(int s, F f) const {
+        int exits = exitsAt[s];
+        if (exits & 1) f(s - 1);
+        if (exits & 2) f(s + 1);
+        if (exits & 4) f(s - width);
+        if (exits & 8) f(s + width);
+    }
+
+    // --- Indexed binary heap ---
+    void heapSet(int i, const std::pair<PlanKey, int>& entry) {
+        heap[i] = entry;
+        state[entry.second].heapPos = i;
+    }
+
+    void siftUp(int i) {
+        auto entry = heap[i];
+        while (i > 0 && entry.first < heap[(i - 1) / 2].first) {
+            heapSet(i, heap[(i - 1) / 2]);
+            i = (i - 1) / 2;
+        }
+        heapSet(i, entry);
+    }
+
+    void siftDown(int i) {
+        auto entry = heap[i];
+        int n = heap.size();
+        while (2 * i + 1 < n) {
+            int child = 2 * i + 1;
+            if (child + 1 < n && heap[child + 1].first < heap[child].first) {
+                child++;
+            }
+            if (!(heap[child].first < entry.first)) {
+                break;
+            }
+            heapSet(i, heap[child]);
+            i = child;
+        }
+        heapSet(i, entry);
+    }
+
+    void heapPush(int s, PlanKey k) {
+        heap.push_back({k, s});
+        state[s].heapPos = heap.size() - 1;
+        siftUp(heap.size() - 1);
+    }
+
+    void heapUpdate(int s, PlanKey k) {
+        int i = state[s].heapPos;
+        bool up = k < heap[i].first;
+        heap[i].first = k;
+        if (up) {
+            siftUp(i);
+        } else {
+            siftDown(i);
+        }
+    }
+
+    void heapRemove(int s) {
+        int i = state[s].heapPos;
+        state[s].heapPos = -1;
+        auto last = heap.back();
+        heap.pop_back();
+        if (i < (int)heap.size()) {
+            heapSet(i, last);
+            siftUp(i);
+            siftDown(state[last.second].heapPos);
+        }
+    }
+
+    // --- D* Lite ---
+    // Put a cell in the heap, move it or take it out, depending on whether
+    // it's consistent
+    void updateState(int s) {
+        bool inHeap = state[s].heapPos >= 0;
+        if (state[s].g != state[s].rhs) {
+            if (inHeap) {
+                heapUpdate(s, key(s));
+            } else {
+                heapPush(s, key(s));
+            }
+        } else if (inHeap) {
+            heapRemove(s);
+        }
+    }
+
+    // Point a cell at its best neighbour again, for when that may have changed
+    void refresh(int s) {
+        if (s == start) {
+            return;
+        }
+        state[s].rhs = INF;
+        state[s].parent = -1;
+        if (!wallAt[s]) {
+            forNeighbors(s, [&](int p) {
+                if (state[p].g + 1 < state[s].rhs) {
+                    state[s].rhs = state[p].g + 1;
+                    state[s].parent = p;
+                }
+            });
+        }
+        updateState(s);
+    }
 
-        // Move the cop to the next tile in the path
-        copX = path[0].first;
-        copY = path[0].second;
+    void computePath() {
+        while (!heap.empty() && (heap[0].first < key(goal) || state[goal].rhs > state[goal].g)) {
+            int u = heap[0].second;
+            PlanKey oldKey = heap[0].first;
+            PlanKey newKey = key(u);
+            if (oldKey < newKey) {
+                heapUpdate(u, newKey);
+            } else if (state[u].g > state[u].rhs) {
+                nodesExpanded++;
+                state[u].g = state[u].rhs;
+                heapRemove(u);
+                forNeighbors(u, [&](int s) {
+                    if (s != start && state[s].rhs > state[u].g + 1) {
+                        state[s].parent = u;
+                        state[s].rhs = state[u].g + 1;
+                        updateState(s);
+                    }
+                });
+            } else {
+                nodesExpanded++;
+                state[u].g = INF;
+                updateState(u);
+                forNeighbors(u, [&](int s) {
+                    if (state[s].parent == u) {
+                        refresh(s);
+                    }
+                });
+            }
+        }
+    }
 
-        // Update cop's position on the map
-        gameMap[copY][copX] = COP;
+    // The robber moved
+    void moveGoal(int cell) {
+        km += heuristic(goal, cell);
+        goal = cell;
+        goalX = goal % width;
+        goalY = goal / width;
+    }
+
+    // The cop moved. Cheap when the new cell is below the old one in the
+    // search tree, which it is after following the path; anything else starts
+    // the search over
+    void moveStart(int cell) {
+        if (cell == start) {
+            return;
+        }
+        int steps = state[cell].g < INF && state[cell].g == state[cell].rhs ? state[cell].g - state[start].g : -1;
+        int s = cell;
+        while (steps > 0 && state[s].parent >= 0) {
+            s = state[s].parent;
+            steps--;
+        }
+        if (s != start || steps != 0) {
+            reset(cell, goal);
+            return;
+        }
+
+        // Everything from the old start down, except below the new one
+        deleted.clear();
+        deleted.push_back(start);
+        for (size_t i = 0; i < deleted.size(); ++i) {
+            int u = deleted[i];
+            forNeighbors(u, [&](int child) {
+                if (child != cell && state[child].parent == u) {
+                    deleted.push_back(child);
+                }
+            });
+        }
+        for (int u : deleted) {
+            state[u].g = state[u].rhs = INF;
+            state[u].parent = -1;
+            if (state[u].heapPos >= 0) {
+                heapRemove(u);
+            }
+        }
+        state[cell].parent = -1;
+        start = cell;
+
+        // Deleted cells next to the kept tree can be reached from it again
+        for (int u : deleted) {
+            refresh(u);
+        }
+    }
+
+    // A wall appeared or went away at cell, exitsAt already updated
+    void wallChanged(int cell) {
+        refresh(cell);
+        forNeighbors(cell, [&](int s) { refresh(s); });
+    }
+
+    // Search as far as needed for the current cop and robber cells. Returns
+    // the cop's next cell and sets length to the steps left, or returns -1
+    // when the robber can't be reached or is already caught
+    int plan(int startCell, int goalCell, int& length) {
+        if (start < 0 || width != gridWidth || (int)state.size() != gridWidth * gridHeight) {
+            reset(startCell, goalCell);
+        } else {
+            moveGoal(goalCell);
+            moveStart(startCell);
+        }
+        computePath();
+
+        length = 0;
+        if (state[goal].rhs >= INF || goal == start) {
+            return -1;
+        }
+        int next = goal;
+        for (int s = goal; s != start; s = state[s].parent) {
+            next = s;
+            length++;
+        }
+        return next;
+    }
+};
+
+ChasePlanner copPlanner;
+
+// Put a wall in or take one out, and let the planner know
+void setWall(int x, int y, bool wall) {
+    gameMap[y][x] = wall ? WALL : EMPTY;
+    int cell = y * gridWidth + x;
+    wallAt[cell] = wall;
+    if (wall) {
+        wallBits[cell >> 6] |= 1ULL << (cell & 63);
+    } else {
+        wallBits[cell >> 6] &= ~(1ULL << (cell & 63));
+    }
+    updateExits(cell);
+    if (x > 0) updateExits(cell - 1);
+    if (x < gridWidth - 1) updateExits(cell + 1);
+    if (y > 0) updateExits(cell - gridWidth);
+    if (y < gridHeight - 1) updateExits(cell + gridWidth);
+    copPlanner.wallChanged(cell);
+}
+
+// --- Shared flow field from the robber ---
+// One breadth-first search from the robber's cell gives every cell its
+// distance to the robber and the direction of the first step there, so any
+// number of cops can each pick their move with one lookup. The walls and the
+// cells already reached share one bitset, 64 cells to a word, which keeps
+// the neighbour checks in cache even on big maps; the frontier is a flat
+// array of cells that's walked in order and never shrinks
+std::vector<unsigned long long> flowBlocked; // wall or already reached
+std::vector<int> flowQueue;
+std::vector<int> flowDist;                  // only valid where flowReached()
+std::vector<unsigned char> flowDir;         // first step: 0 left, 1 right, 2 up, 3 down, 4 none
+long long flowCellsVisited = 0;             // for the benchmark
+
+bool flowReached(int cell) {
+    return (flowBlocked[cell >> 6] >> (cell & 63) & 1) && !(wallBits[cell >> 6] >> (cell & 63) & 1);
+}
+
+void computeFlowField(int target) {
+    int cells = gridWidth * gridHeight;
+    flowBlocked = wallBits; // same size every time, so this only copies
+    flowQueue.resize(cells);
+    flowDist.resize(cells);
+    flowDir.resize(cells);
+
+    int head = 0;
+    int tail = 0;
+    flowQueue[tail++] = target;
+    flowBlocked[target >> 6] |= 1ULL << (target & 63);
+    flowDist[target] = 0;
+    flowDir[target] = 4;
+
+    // Reaches n from u, so the step from n is back the other way
+    auto visit = [&](int n, int distance, unsigned char dir) {
+        unsigned long long bit = 1ULL << (n & 63);
+        if (!(flowBlocked[n >> 6] & bit)) {
+            flowBlocked[n >> 6] |= bit;
+            flowDist[n] = distance;
+            flowDir[n] = dir;
+            flowQueue[tail++] = n;
+        }
+    };
+
+    int distance = 0;
+    int levelEnd = tail;
+    while (head < tail) {
+        if (head == levelEnd) {
+            distance++;
+            levelEnd = tail;
+        }
+        int u = flowQueue[head++];
+        int x = u % gridWidth;
+        if (x > 0) visit(u - 1, distance + 1, 1);
+        if (x < gridWidth - 1) visit(u + 1, distance + 1, 0);
+        if (u >= gridWidth) visit(u - gridWidth, distance + 1, 3);
+        if (u + gridWidth < cells) visit(u + gridWidth, distance + 1, 2);
+    }
+    flowCellsVisited += tail;
+}
+
+// Where a cop on 'cell' should go next, or -1 when it can't reach the robber
+// or is already there
+int flowStep(int cell) {
+    if (!flowReached(cell) || flowDir[cell] == 4) {
+        return -1;
+    }
+    const int offsets[] = {-1, 1, -gridWidth, gridWidth};
+    return cell + offsets[flowDir[cell]];
+}
+
+std::vector<int> copMoves; // where each cop goes this tick, -1 to stay
+
+// Every cop's next cell from one flow field toward the robber
+void planCopsByField() {
+    computeFlowField(robberY * gridWidth + robberX);
+    copMoves.resize(cops.size());
+    for (size_t i = 0; i < cops.size(); ++i) {
+        copMoves[i] = flowStep(cops[i].y * gridWidth + cops[i].x);
+    }
+}
+
+// Apply copMoves in cop order. A cop doesn't step onto another one, so when
+// two want the same cell the first in the list gets it
+void applyCopMoves() {
+    for (size_t i = 0; i < cops.size(); ++i) {
+        int next = copMoves[i];
+        if (next < 0) {
+            continue;
+        }
+        int x = next % gridWidth;
+        int y = next / gridWidth;
+        if (gameMap[y][x] == COP) {
+            continue;
+        }
+        Cop& cop = cops[i];
+        gameMap[cop.y][cop.x] = cop.under;
+        cop.x = x;
+        cop.y = y;
+        cop.under = gameMap[y][x] == ROBBER ? EMPTY : gameMap[y][x];
+        gameMap[y][x] = COP;
 
         // Check for collision after the move
-        if (copX == robberX && copY == robberY) {
+        if (cop.x == robberX && cop.y == robberY) {
             gameOver = true;
         }
     }
 }
 
+// AI for the cops: chase the robber. A lone cop replans incrementally, a
+// group shares one flow field each tick
+void moveCops() {
+    if (cops.size() == 1) {
+        int length;
+        copMoves.assign(1, copPlanner.plan(cops[0].y * gridWidth + cops[0].x, robberY * gridWidth + robberX, length));
+    } else {
+        planCopsByField();
+    }
+    applyCopMoves();
+}
+
+// Put cops 1 .. count - 1 on open cells away from the robber; cop 0 keeps
+// its place. The same map always gets the same cops
+void placeCops(int count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<int> open;
+    for (int cell = 0; cell < gridWidth * gridHeight; ++cell) {
+        int x = cell % gridWidth;
+        int y = cell / gridWidth;
+        if (!wallAt[cell] && gameMap[y][x] != COP && gameMap[y][x] != ROBBER &&
+            std::abs(x - robberX) + std::abs(y - robberY) >= 8) {
+            open.push_back(cell);
+        }
+    }
+    cops.resize(1);
+    while ((int)cops.size() < count && !open.empty()) {
+        int pick = rng() % open.size();
+        int cell = open[pick];
+        open[pick] = open.back();
+        open.pop_back();
+        int x = cell % gridWidth;
+        int y = cell / gridWidth;
+        cops.push_back({x, y, gameMap[y][x]});
+        gameMap[y][x] = COP;
+    }
+}
+
 // Main game loop
-void gameLoop() {
+void gameLoop(int copCount) {
     char input;
     static int frameCounter = 0;
     
     // Initial setup on the map
     gameMap[robberY][robberX] = ROBBER;
-    gameMap[copY][copX] = COP;
+    gameMap[cops[0].y][cops[0].x] = COP;
+    buildGrid();
+    placeCops(copCount, 1);
 
     // --- Cross-platform function for non-blocking input ---
 #ifndef _WIN32
@@ -278,15 +808,17 @@ void gameLoop() {
         // Move the robber based on the stored direction
         moveRobber(currentRobberDirection);
 
-        // Move the cop 2 times for every 3 frames
+        // Move the cops 2 times for every 3 frames
         frameCounter++;
         if (frameCounter % 3 != 0) {
-            moveCop();
+            moveCops();
         }
 
         // Check if the robber has been caught
-        if (robberX == copX && robberY == copY) {
-            gameOver = true;
+        for (const Cop& cop : cops) {
+            if (robberX == cop.x && robberY == cop.y) {
+                gameOver = true;
+            }
         }
 
         // Wait for a moment to slow down the game
@@ -312,7 +844,484 @@ void gameLoop() {
     std::cout << "Final Score: " << score << std::endl;
 }
 
-int main() {
+// --- Benchmark ---
+// Carve a random maze into gameMap: a recursive backtracker over the odd
+// cells, then one wall in 'loops' knocked out so there's more than one way
+// around. width and height are rounded up to odd numbers
+void generateMaze(int width, int height, unsigned seed, int loops) {
+    width |= 1;
+    height |= 1;
+    std::mt19937 rng(seed);
+    gameMap.assign(height, std::string(width, WALL));
+
+    std::vector<std::pair<int, int>> stack = {{1, 1}};
+    gameMap[1][1] = EMPTY;
+    int dx[] = {0, 0, 2, -2};
+    int dy[] = {2, -2, 0, 0};
+    while (!stack.empty()) {
+        int x = stack.back().first;
+        int y = stack.back().second;
+        int options[4];
+        int count = 0;
+        for (int i = 0; i < 4; ++i) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if (nx > 0 && nx < width - 1 && ny > 0 && ny < height - 1 && gameMap[ny][nx] == WALL) {
+                options[count++] = i;
+            }
+        }
+        if (count == 0) {
+            stack.pop_back();
+            continue;
+        }
+        int i = options[rng() % count];
+        gameMap[y + dy[i] / 2][x + dx[i] / 2] = EMPTY;
+        gameMap[y + dy[i]][x + dx[i]] = EMPTY;
+        stack.push_back({x + dx[i], y + dy[i]});
+    }
+
+    // Walls between two corridors, either side by side or one above the other
+    if (loops > 0) {
+        for (int y = 1; y < height - 1; ++y) {
+            for (int x = 1; x < width - 1; ++x) {
+                bool between = (x % 2 == 0) != (y % 2 == 0);
+                if (between && gameMap[y][x] == WALL && rng() % loops == 0) {
+                    gameMap[y][x] = EMPTY;
+                }
+            }
+        }
+    }
+}
+
+// Time findPath between random open cells of a generated maze
+void runBenchmark(int width, int height, int queries, unsigned seed) {
+    generateMaze(width, height, seed, 20);
+    buildGrid();
+
+    std::vector<int> open;
+    for (int cell = 0; cell < gridWidth * gridHeight; ++cell) {
+        if (!wallAt[cell]) {
+            open.push_back(cell);
+        }
+    }
+    std::mt19937 rng(seed + 1);
+    std::vector<std::pair<int, int>> path;
+    long long steps = 0;
+    int found = 0;
+    mainScratch.nodesExpanded = 0;
+
+    auto started = std::chrono::steady_clock::now();
+    for (int q = 0; q < queries; ++q) {
+        int from = open[rng() % open.size()];
+        int to = open[rng() % open.size()];
+        findPath(from % gridWidth, from / gridWidth, to % gridWidth, to / gridWidth, path);
+        steps += path.size();
+        found += !path.empty() || from == to;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    std::cout << "maze " << gridWidth << "x" << gridHeight << ", " << queries << " searches ("
+              << found << " found), " << mainScratch.nodesExpanded << " nodes expanded, "
+              << steps / std::max(1, found) << " steps per path" << std::endl;
+    std::cout << seconds * 1e9 / std::max(1LL, mainScratch.nodesExpanded) << " ns per expanded node, "
+              << seconds * 1e6 / queries << " us per search" << std::endl;
+}
+
+// Chase a robber that wanders at random through a generated maze, replanning
+// every tick with the incremental planner and with a fresh A* to compare.
+// Every 'wallEvery' ticks a wall between two corridors is put in or taken out.
+// 'loops' goes to generateMaze, the lower the more open the maze
+void runChaseBenchmark(int width, int height, int ticks, unsigned seed, int wallEvery, int loops) {
+    generateMaze(width, height, seed, loops);
+    buildGrid();
+
+    std::vector<int> open;
+    for (int cell = 0; cell < gridWidth * gridHeight; ++cell) {
+        if (!wallAt[cell]) {
+            open.push_back(cell);
+        }
+    }
+    std::mt19937 rng(seed + 1);
+    int cop = open[rng() % open.size()];
+    int robber = open[rng() % open.size()];
+    copPlanner.reset(cop, robber);
+    std::vector<std::pair<int, int>> path;
+    double incrementalSeconds = 0, freshSeconds = 0;
+    long long freshExpanded = 0;
+    int mismatches = 0, catches = 0, wallChanges = 0;
+
+    for (int tick = 0; tick < ticks; ++tick) {
+        // The robber takes a random open step, or stays put
+        int neighbors[4];
+        int count = 0;
+        copPlanner.forNeighbors(robber, [&](int s) { neighbors[count++] = s; });
+        if (count > 0 && rng() % 5 != 0) {
+            robber = neighbors[rng() % count];
+        }
+
+        if (wallEvery > 0 && tick % wallEvery == wallEvery - 1) {
+            int x = 1 + rng() % (gridWidth - 2);
+            int y = 1 + rng() % (gridHeight - 2);
+            int cell = y * gridWidth + x;
+            if ((x % 2 == 0) != (y % 2 == 0) && cell != cop && cell != robber) {
+                setWall(x, y, !wallAt[cell]);
+                wallChanges++;
+            }
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        int length;
+        int next = copPlanner.plan(cop, robber, length);
+        auto planned = std::chrono::steady_clock::now();
+        mainScratch.nodesExpanded = 0;
+        findPath(cop % gridWidth, cop / gridWidth, robber % gridWidth, robber / gridWidth, path);
+        auto searched = std::chrono::steady_clock::now();
+        incrementalSeconds += std::chrono::duration<double>(planned - started).count();
+        freshSeconds += std::chrono::duration<double>(searched - planned).count();
+        freshExpanded += mainScratch.nodesExpanded;
+        if (length != (int)path.size()) {
+            mismatches++;
+        }
+
+        // The cop moves 2 ticks out of 3, like in the game
+        if (next >= 0 && tick % 3 != 2) {
+            cop = next;
+        }
+        if (cop == robber) {
+            catches++;
+            robber = open[rng() % open.size()];
+        }
+    }
+
+    std::cout << "maze " << gridWidth << "x" << gridHeight << ", " << ticks << " ticks, " << catches
+              << " catches, " << wallChanges << " wall changes, " << mismatches
+              << " path lengths different from A*" << std::endl;
+    std::cout << "incremental: " << incrementalSeconds * 1e6 / ticks << " us per tick, "
+              << (double)copPlanner.nodesExpanded / ticks << " nodes per tick" << std::endl;
+    std::cout << "fresh A*:    " << freshSeconds * 1e6 / ticks << " us per tick, "
+              << (double)freshExpanded / ticks << " nodes per tick" << std::endl;
+}
+
+// Many cops on a generated maze chase a robber that wanders at random, all
+// steering by one flow field per tick. A few of the cops also run findPath
+// each tick, to check the distances and to see what a search per cop costs
+void runFlowBenchmark(int width, int height, int cops, int ticks, unsigned seed) {
+    generateMaze(width, height, seed, 20);
+    buildGrid();
+
+    std::vector<int> open;
+    for (int cell = 0; cell < gridWidth * gridHeight; ++cell) {
+        if (!wallAt[cell]) {
+            open.push_back(cell);
+        }
+    }
+    std::mt19937 rng(seed + 1);
+    int robber = open[rng() % open.size()];
+    std::vector<int> copCells(cops);
+    for (int& cop : copCells) {
+        cop = open[rng() % open.size()];
+    }
+    const int sampled = std::min(cops, 4);
+    std::vector<std::pair<int, int>> path;
+    double fieldSeconds = 0, stepSeconds = 0, searchSeconds = 0;
+    int mismatches = 0, catches = 0;
+    flowCellsVisited = 0;
+
+    for (int tick = 0; tick < ticks; ++tick) {
+        int neighbors[4];
+        int count = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int offsets[] = {-1, 1, -gridWidth, gridWidth};
+            if (exitsAt[robber] >> i & 1) {
+                neighbors[count++] = robber + offsets[i];
+            }
+        }
+        if (count > 0 && rng() % 5 != 0) {
+            robber = neighbors[rng() % count];
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        computeFlowField(robber);
+        auto computed = std::chrono::steady_clock::now();
+        for (int i = 0; i < sampled; ++i) {
+            int cop = copCells[i];
+            findPath(cop % gridWidth, cop / gridWidth, robber % gridWidth, robber / gridWidth, path);
+            if ((int)path.size() != (flowReached(cop) ? flowDist[cop] : 0)) {
+                mismatches++;
+            }
+        }
+        auto searched = std::chrono::steady_clock::now();
+        // The cops move 2 ticks out of 3, like in the game
+        if (tick % 3 != 2) {
+            for (int& cop : copCells) {
+                int next = flowStep(cop);
+                if (next >= 0) {
+                    cop = next;
+                }
+                if (cop == robber) {
+                    catches++;
+                }
+            }
+        }
+        auto stepped = std::chrono::steady_clock::now();
+        fieldSeconds += std::chrono::duration<double>(computed - started).count();
+        searchSeconds += std::chrono::duration<double>(searched - computed).count();
+        stepSeconds += std::chrono::duration<double>(stepped - searched).count();
+
+        // A caught robber gets away somewhere else
+        for (int cop : copCells) {
+            if (cop == robber) {
+                robber = open[rng() % open.size()];
+                break;
+            }
+        }
+    }
+
+    std::cout << "maze " << gridWidth << "x" << gridHeight << ", " << cops << " cops, " << ticks << " ticks, "
+              << catches << " catches, " << mismatches << " distances different from A*" << std::endl;
+    std::cout << "flow field: " << fieldSeconds * 1e3 / ticks << " ms per tick ("
+              << fieldSeconds * 1e9 / std::max(1LL, flowCellsVisited) << " ns per cell), cop steps: "
+              << stepSeconds * 1e6 / ticks << " us per tick" << std::endl;
+    std::cout << "findPath per cop: " << searchSeconds * 1e3 / ticks / sampled << " ms, so "
+              << searchSeconds * 1e3 / ticks / sampled * cops << " ms per tick for all of them" << std::endl;
+}
+
+// Planning the cops in parallel.
+// Each cop's search only reads the walls and writes that cop's entry of
+// copMoves, so the searches can run on any thread in any order. Every thread
+// has its own search scratch, and the moves are applied afterwards in cop
+// order, so the outcome doesn't depend on the number of threads or on which
+// thread got which cop.
+// The game doesn't plan this way: all its cops chase the same cell, which
+// the flow field answers for every cop with one search, and on 1001x1001 one
+// field costs about as much as one or two cop searches. Only --bench-cops
+// uses the pool, to measure it against the field
+struct CopPool {
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned round = 0;
+    int working = 0;
+    bool stopping = false;
+};
+
+CopPool copPool;
+std::vector<SearchScratch> copScratch(1); // one per planning thread, [0] is the main thread's
+std::atomic<size_t> nextCop{0};
+
+// Plan cops until there are none left this round
+void planCops(SearchScratch& scratch) {
+    static thread_local std::vector<std::pair<int, int>> path;
+    for (size_t i; (i = nextCop.fetch_add(1, std::memory_order_relaxed)) < cops.size();) {
+        findPath(cops[i].x, cops[i].y, robberX, robberY, path, scratch);
+        copMoves[i] = path.empty() ? -1 : path[0].second * gridWidth + path[0].first;
+    }
+}
+
+void copWorker(int worker) {
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> hold(copPool.lock);
+            copPool.wake.wait(hold, [&] { return copPool.stopping || copPool.round != seen; });
+            if (copPool.stopping) return;
+            seen = copPool.round;
+        }
+        planCops(copScratch[worker]);
+        std::lock_guard<std::mutex> hold(copPool.lock);
+        if (--copPool.working == 0) copPool.done.notify_one();
+    }
+}
+
+// Plan with 'threads' threads in all, the main thread being one of them
+void startCopThreads(int threads) {
+    copScratch.resize(std::max(1, threads));
+    copPool.stopping = false;
+    for (int worker = 1; worker < threads; ++worker) {
+        copPool.threads.emplace_back(copWorker, worker);
+    }
+}
+
+void stopCopThreads() {
+    {
+        std::lock_guard<std::mutex> hold(copPool.lock);
+        copPool.stopping = true;
+    }
+    copPool.wake.notify_all();
+    for (std::thread& thread : copPool.threads) thread.join();
+    copPool.threads.clear();
+}
+
+// Find every cop's next cell toward the robber
+void planAllCops() {
+    copMoves.assign(cops.size(), -1);
+    nextCop.store(0, std::memory_order_relaxed);
+    if (copPool.threads.empty()) {
+        planCops(copScratch[0]);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> hold(copPool.lock);
+        copPool.round++;
+        copPool.working = copPool.threads.size();
+    }
+    copPool.wake.notify_all();
+    planCops(copScratch[0]);
+    std::unique_lock<std::mutex> hold(copPool.lock);
+    copPool.done.wait(hold, [&] { return copPool.working == 0; });
+}
+
+// A crowd of cops planned with a search each on 1, 2, 4 .. maxThreads
+// threads, and then with the flow field the game uses, chasing a robber that
+// wanders at random through a generated maze. Every run starts the same, so
+// the searching cops should end up in the same places whatever the thread
+// count; the field breaks ties between equally short ways differently
+void runCopsBenchmark(int width, int height, int copCount, int ticks, unsigned seed, int maxThreads) {
+    std::vector<int> runs;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        runs.push_back(threads);
+    }
+    runs.push_back(0); // 0: the flow field
+    double oneThread = 0;
+    for (int threads : runs) {
+        generateMaze(width, height, seed, 20);
+        buildGrid();
+        std::vector<int> open;
+        for (int cell = 0; cell < gridWidth * gridHeight; ++cell) {
+            if (!wallAt[cell]) {
+                open.push_back(cell);
+            }
+        }
+        std::mt19937 rng(seed + 1);
+        int robber = open[rng() % open.size()];
+        robberX = robber % gridWidth;
+        robberY = robber / gridWidth;
+        int first = open[rng() % open.size()];
+        cops.assign(1, {first % gridWidth, first / gridWidth, EMPTY});
+        gameMap[cops[0].y][cops[0].x] = COP;
+        placeCops(copCount, seed);
+        startCopThreads(threads);
+
+        double seconds = 0;
+        unsigned long long fingerprint = 14695981039346656037ULL;
+        int catches = 0;
+        for (int tick = 0; tick < ticks; ++tick) {
+            robber = robberY * gridWidth + robberX;
+            const int offsets[] = {-1, 1, -gridWidth, gridWidth};
+            int i = rng() % 5;
+            if (i < 4 && (exitsAt[robber] >> i & 1)) {
+                robberX = (robber + offsets[i]) % gridWidth;
+                robberY = (robber + offsets[i]) / gridWidth;
+            }
+
+            auto started = std::chrono::steady_clock::now();
+            gameOver = false;
+            if (threads == 0) {
+                planCopsByField();
+            } else {
+                planAllCops();
+            }
+            applyCopMoves();
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+            for (const Cop& cop : cops) {
+                fingerprint = (fingerprint ^ (cop.y * gridWidth + cop.x)) * 1099511628211ULL;
+            }
+            // A caught robber gets away somewhere else
+            if (gameOver) {
+                catches++;
+                do {
+                    robber = open[rng() % open.size()];
+                } while (gameMap[robber / gridWidth][robber % gridWidth] == COP);
+                robberX = robber % gridWidth;
+                robberY = robber / gridWidth;
+            }
+        }
+        stopCopThreads();
+        gameOver = false;
+
+        if (threads == 1) {
+            oneThread = seconds;
+        }
+        std::cout << "maze " << gridWidth << "x" << gridHeight << ", " << cops.size() << " cops, "
+                  << (threads == 0 ? "flow field" : std::to_string(threads) + " threads") << ": " << seconds * 1e3 / ticks << " ms per tick, " << oneThread / seconds
+                  << "x, " << catches << " catches, cops " << std::hex << fingerprint << std::dec << std::endl;
+    }
+}
+
+// Usage: cops-n-robbers-2 [--cops n]
+//        cops-n-robbers-2 --bench [width] [height] [searches] [seed]
+//        cops-n-robbers-2 --bench-chase [width] [height] [ticks] [seed] [ticks per wall change] [loops]
+//        cops-n-robbers-2 --bench-flow [width] [height] [cops] [ticks] [seed]
+//        cops-n-robbers-2 --bench-cops [width] [height] [cops] [ticks] [seed] [max threads]
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench-cops") == 0) {
+        int width = argc > 2 ? std::atoi(argv[2]) : 1001;
+        int height = argc > 3 ? std::atoi(argv[3]) : 1001;
+        int copCount = argc > 4 ? std::atoi(argv[4]) : 64;
+        int ticks = argc > 5 ? std::atoi(argv[5]) : 20;
+        unsigned seed = argc > 6 ? std::atoi(argv[6]) : 1;
+        int maxThreads = argc > 7 ? std::atoi(argv[7]) : 32;
+        if (width < 3 || height < 3 || copCount < 1 || ticks < 1 || maxThreads < 1) {
+            std::cerr << "usage: cops-n-robbers-2 --bench-cops [width] [height] [cops] [ticks] [seed] [max threads]"
+                      << std::endl;
+            return 1;
+        }
+        runCopsBenchmark(width, height, copCount, ticks, seed, maxThreads);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-flow") == 0) {
+        int width = argc > 2 ? std::atoi(argv[2]) : 1001;
+        int height = argc > 3 ? std::atoi(argv[3]) : 1001;
+        int cops = argc > 4 ? std::atoi(argv[4]) : 500;
+        int ticks = argc > 5 ? std::atoi(argv[5]) : 200;
+        unsigned seed = argc > 6 ? std::atoi(argv[6]) : 1;
+        if (width < 3 || height < 3 || cops < 1 || ticks < 1) {
+            std::cerr << "usage: cops-n-robbers-2 --bench-flow [width] [height] [cops] [ticks] [seed]" << std::endl;
+            return 1;
+        }
+        runFlowBenchmark(width, height, cops, ticks, seed);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-chase") == 0) {
+        int width = argc > 2 ? std::atoi(argv[2]) : 1001;
+        int height = argc > 3 ? std::atoi(argv[3]) : 1001;
+        int ticks = argc > 4 ? std::atoi(argv[4]) : 2000;
+        unsigned seed = argc > 5 ? std::atoi(argv[5]) : 1;
+        int wallEvery = argc > 6 ? std::atoi(argv[6]) : 0;
+        int loops = argc > 7 ? std::atoi(argv[7]) : 20;
+        if (width < 3 || height < 3 || ticks < 1) {
+            std::cerr << "usage: cops-n-robbers-2 --bench-chase [width] [height] [ticks] [seed] [ticks per wall change] [loops]"
+                      << std::endl;
+            return 1;
+        }
+        runChaseBenchmark(width, height, ticks, seed, wallEvery, loops);
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        int width = argc > 2 ? std::atoi(argv[2]) : 1001;
+        int height = argc > 3 ? std::atoi(argv[3]) : 1001;
+        int queries = argc > 4 ? std::atoi(argv[4]) : 200;
+        unsigned seed = argc > 5 ? std::atoi(argv[5]) : 1;
+        if (width < 3 || height < 3 || queries < 1) {
+            std::cerr << "usage: cops-n-robbers-2 --bench [width] [height] [searches] [seed]" << std::endl;
+            return 1;
+        }
+        runBenchmark(width, height, queries, seed);
+        return 0;
+    }
+
+    int copCount = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cops") == 0 && i + 1 < argc) {
+            copCount = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "Welcome to Cops and Robbers!" << std::endl;
     std::cout << "Use W, A, S, D to move. Collect all the 'o's without getting caught!" << std::endl;
     std::cout << "Press any key to start..." << std::endl;
@@ -322,7 +1331,7 @@ int main() {
     char c;
     read(STDIN_FILENO, &c, 1);
 #endif
-    gameLoop();
+    gameLoop(copCount);
     return 0;
 }
 
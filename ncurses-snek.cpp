@@ -1,13 +1,29 @@
 #include <ncurses.h>
 #include <iostream>
 #include <vector>
-#include <ctime>
 #include <cstdlib>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <cerrno>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <random>
 
-//screen dimensions
-const int MAX_Y = 25;
-const int MAX_X =  80;
+//board dimensions, the old screen size unless --board says otherwise
+const int DEFAULT_ROWS = 25;
+const int DEFAULT_COLS = 80;
+const int MIN_BOARD_ROWS = 4;
+const int MIN_BOARD_COLS = 5;
+const int MAX_BOARD_SIDE = 4096;
+
+//true for a board --board accepts, replays are held to the same
+bool boardSizeOk(int rows, int cols) {
+    return rows >= MIN_BOARD_ROWS && cols >= MIN_BOARD_COLS && rows <= MAX_BOARD_SIDE && cols <= MAX_BOARD_SIDE;
+}
 
 //game states
 enum Direction { UP, DOWN, LEFT, RIGHT };
@@ -17,14 +33,218 @@ struct Point {
     int y, x;
 };
 
+//board size the game runs on. the board has nothing to do with the terminal:
+//the screen shows the part of it around the head, see the camera below.
+//rows 0 & columns 0, cols - 1 are walls, the bottom row can be played on
+int boardRows = DEFAULT_ROWS;
+int boardCols = DEFAULT_COLS;
+//board cell at the top left of the screen
+int cameraY = 0;
+int cameraX = 0;
+
 //global vars
-std::vector<Point> snake;
+//the snake is a ring buffer of cell indices (y * boardCols + x), head first.
+//it holds the whole board so it never grows, moving is a head push & a tail pop
+std::vector<int> snakeRing;
+size_t snakeHead = 0; //ring slot of the head
+size_t snakeLength = 0;
+//one bit per board cell, set where the snake is
+std::vector<unsigned long long> occupied;
+int growPending = 0; //ticks the tail stays put, so the snake gets longer
+//cells food can go on that the snake isn't on, in no particular order, and
+//where each cell is in that list (or one of the values below). kept up to
+//date on every head push & tail pop, so picking a spot for food is O(1)
+std::vector<int> freeCells;
+std::vector<int> freeIndex;
+const int TAKEN = -1;   //the snake is there
+const int OUTSIDE = -2; //food never goes there
+std::mt19937 rng; //seeded once in main, so a seed replays the same food
 Point food;
 Direction direction;
+//the way the last update() moved; several keys can come in between two
+//moves, so turning back is checked against this, not against 'direction'
+Direction movedDirection;
 int score = 0;
 bool gameOver = false;
 bool isPaused = false;
-int usleepDelay = 100000;
+int tickMicros = 100000; //time between ticks, gets shorter as the score goes up
+const int MIN_TICK_MICROS = 10000;
+bool showStats = false; //'h' shows the timing histograms over the board
+
+//log2 histogram of microseconds: bucket 0 counts 0 us, bucket b > 0 counts
+//[2^(b-1), 2^b) us, the last one everything above
+const int HISTOGRAM_BUCKETS = 24;
+struct Histogram {
+    const char* name;
+    long counts[HISTOGRAM_BUCKETS];
+    long samples;
+    long maxMicros;
+};
+//how late each tick fired after its scheduled time
+Histogram tickJitter = {"tick jitter", {}, 0, 0};
+//from a key that turns the snake to the tick that moves it that way
+Histogram inputLatency = {"input to move", {}, 0, 0};
+//from the timer firing to the tick being on screen, the drawing part should
+//take the same time at any snake length
+Histogram renderTime = {"update + draw", {}, 0, 0};
+long missedTicks = 0; //ticks that fired late enough to be run back to back
+bool turnPending = false;
+std::chrono::steady_clock::time_point turnPressedAt;
+bool repaintNeeded = false; //the screen needs a full draw() instead of drawTick()
+
+//what the last update() changed on the board, so drawTick() only touches that
+struct TickChanges {
+    bool moved;
+    int oldHead; //now a body segment
+    int newHead;
+    int vacated; //where the tail was, -1 if the snake grew
+    bool ate;    //food & score changed
+};
+TickChanges changes = {false, 0, 0, -1, false};
+
+//replays: a game is its seed plus the ticks where the direction changed.
+//the file is a header (REPLAY_MAGIC, version, seed, board size, all little
+//endian) and then one varint per event: (ticks since the last event << 3) |
+//kind, kind being the new Direction or one of the two ends below. an end is
+//followed by a varint with the final score
+const char REPLAY_MAGIC[4] = {'S', 'N', 'K', 'R'};
+const int REPLAY_VERSION = 1;
+enum ReplayEnd { END_GAME_OVER = 4, END_QUIT = 5 };
+struct ReplayEvent {
+    long tick; //update() number the event happens before
+    int kind;
+};
+struct Replay {
+    unsigned seed;
+    int rows, cols;
+    std::vector<ReplayEvent> events; //the last one is an end
+    long score;
+};
+unsigned gameSeed = 0; //rng seed of the current game
+long tickCount = 0;    //update() calls this game
+bool quitGame = false; //the player quit, the game didn't end by itself
+//the game being recorded, appended to by update(), written out at the end
+std::vector<unsigned char> recording;
+long lastEventTick = 0;
+Direction recordedDirection = RIGHT;
+//a replay being played back drives the direction instead of the keys
+const Replay* playback = nullptr;
+size_t playbackEvent = 0;
+int playbackSpeed = 1;
+
+//autopilot: a Hamiltonian cycle through every cell the snake can be on, the
+//bottom play row included though food never goes there. the cycle is kept
+//as a spanning tree over 2x2 blocks of cells: inside a block it runs
+//counterclockwise, and it crosses to a neighbouring block wherever the tree
+//has an edge, so it goes once around the tree & through every cell. which
+//way a cell goes on depends on one edge only (cycleNext). the snake always
+//moves to the head's successor, so every segment but the head has the next
+//one as its successor & the body is one stretch of the cycle. the head's
+//successor is then empty, or the tail once the snake is on every cell, when
+//the board is already full: the snake can't run into itself.
+//shortcuts reshape the tree instead of leaving the cycle. for each food a
+//short path to it is laid into the tree (planRoute), only changing edges no
+//body segment's successor depends on, so the above keeps holding at every
+//length, with no cutoff. blocks with no body in them hang off the body
+//through treeParent: a block is only ever hung on a block outside what
+//hangs below it, so the edges stay a tree
+bool autopilot = false;
+int blockRows = 0, blockCols = 0; //the board the snake can be on, in 2x2 blocks
+//edge 2b joins block b to the one on its right, 2b + 1 to the one below
+std::vector<char> treeEdge;
+std::vector<int> treeParent; //next block towards the body, for blocks without body
+int treeRows = 0, treeCols = 0; //board the tree was built for
+//planRoute's scratch, sized with the tree. a cell or block is marked when
+//its entry equals the current stamp, so nothing needs clearing
+std::vector<int> route; //the cells from the head to the food
+std::vector<int> routeCuts; //cells on 'route' it goes on around the block from, cutting their edge
+std::vector<int> walkRoute, walkCuts; //the same for the way the cycle goes
+std::vector<int> routeFrom, routeLength, searchSeen; //per route state
+std::vector<int> onRoute; //per cell
+std::vector<int> cellBlock, cellEdges; //per cell, what blockOf & cellEdge give
+std::vector<char> cellCorner;          //per cell, what cornerOf gives
+std::vector<int> blockSeen, foodSide; //per block
+std::vector<int> openStates[2], blockQueue, hangChain;
+int routeStamp = 0, blockStamp = 0, foodStamp = 0;
+std::vector<int> blockBody; //segments in each block, kept by autopilotDirection
+int routeStep = -1;     //where the head is on 'route', -1 when there's none to follow
+bool detouring = false; //going around blocks a cut was left out for, back to route[routeStep]
+long replanAt = -1;     //tick a detour has gone on long enough to plan again from where the head is
+int plannedFood = -1;   //the food cell planRoute last ran for
+const int ROUTE_EFFORT = 8;    //how hard findRoute looks
+const int DETOUR_REPLAN = 256; //the tail has opened up some of what the detour goes around by then
+int hangEdge = -1, hangFrom = -1, hangTo = -1; //what findHanger found
+
+int cellOf(int y, int x) {
+    return y * boardCols + x;
+}
+
+Point pointOf(int cell) {
+    return {cell / boardCols, cell % boardCols};
+}
+
+bool isOccupied(int cell) {
+    return occupied[cell >> 6] >> (cell & 63) & 1;
+}
+
+//i-th segment from the head
+int segmentAt(size_t i) {
+    size_t slot = snakeHead + i;
+    if (slot >= snakeRing.size()) slot -= snakeRing.size();
+    return snakeRing[slot];
+}
+
+void takeCell(int cell) {
+    int index = freeIndex[cell];
+    if (index < 0) return;
+    //move the last free cell into the hole
+    int last = freeCells.back();
+    freeCells[index] = last;
+    freeIndex[last] = index;
+    freeCells.pop_back();
+    freeIndex[cell] = TAKEN;
+}
+
+void releaseCell(int cell) {
+    if (freeIndex[cell] != TAKEN) return;
+    freeIndex[cell] = static_cast<int>(freeCells.size());
+    freeCells.push_back(cell); //capacity is reserved for every cell
+}
+
+void pushHead(int cell) {
+    snakeHead = (snakeHead == 0 ? snakeRing.size() : snakeHead) - 1;
+    snakeRing[snakeHead] = cell;
+    snakeLength++;
+    occupied[cell >> 6] |= 1ull << (cell & 63);
+    takeCell(cell);
+}
+
+void popTail() {
+    int cell = segmentAt(--snakeLength);
+    occupied[cell >> 6] &= ~(1ull << (cell & 63));
+    releaseCell(cell);
+}
+
+//size the snake & bitmap for the board, only allocates when the size changes
+void initBoard(int rows, int cols) {
+    boardRows = rows;
+    boardCols = cols;
+    size_t cells = static_cast<size_t>(rows) * cols;
+    snakeRing.assign(cells, 0);
+    occupied.assign((cells + 63) / 64, 0);
+    snakeHead = 0;
+    snakeLength = 0;
+    //food goes inside the border, rows 1 .. rows - 2 & columns 1 .. cols - 2
+    freeCells.clear();
+    freeCells.reserve(cells);
+    freeIndex.assign(cells, OUTSIDE);
+    for (int y = 1; y < rows - 1; ++y) {
+        for (int x = 1; x < cols - 1; ++x) {
+            freeIndex[cellOf(y, x)] = static_cast<int>(freeCells.size());
+            freeCells.push_back(cellOf(y, x));
+        }
+    }
+}
 
 //init ncurses
 
@@ -34,66 +254,768 @@ void setup() {
     noecho(); //dont echo input chars
     keypad(stdscr, TRUE); //Enable special keys
     curs_set(0); // hide cursor
-    timeout(100); //wait 100ms for input
-    srand(time(0)); //seed random number generator
+    timeout(0); //getch doesn't wait, poll() in main waits for input
 }
 
-//draw game board and elements
+void record(Histogram& histogram, long micros) {
+    micros = std::max(0L, micros);
+    int bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && (1L << bucket) <= micros) bucket++;
+    histogram.counts[bucket]++;
+    histogram.samples++;
+    histogram.maxMicros = std::max(histogram.maxMicros, micros);
+}
 
-void draw() {
-    clear();
-    box(stdscr, 0, 0);
+//upper bound in us of the bucket that holds the p-th percentile
+long percentile(const Histogram& histogram, double p) {
+    long seen = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+        seen += histogram.counts[bucket];
+        if (seen > 0 && seen >= p / 100 * histogram.samples) return 1L << bucket;
+    }
+    return 0;
+}
+
+//one line per histogram, then one per non-empty bucket, handed to 'line'
+//so the same text goes on the board or to the terminal after the game
+template <typename Line>
+void describe(const Histogram& histogram, Line line) {
+    char text[96];
+    snprintf(text, sizeof(text), "%s: %ld, p50 < %ld us, p99 < %ld us, max %ld us", histogram.name,
+             histogram.samples, percentile(histogram, 50), percentile(histogram, 99), histogram.maxMicros);
+    line(text);
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; ++bucket) {
+        if (histogram.counts[bucket] == 0) continue;
+        snprintf(text, sizeof(text), "  < %7ld us %8ld", 1L << bucket, histogram.counts[bucket]);
+        line(text);
+    }
+}
+
+void drawStats() {
+    int row = 2;
+    auto line = [&](const char* text) {
+        if (row < LINES - 1) mvprintw(row++, 2, "%s", text);
+    };
+    describe(tickJitter, line);
+    describe(inputLatency, line);
+    describe(renderTime, line);
+    char text[64];
+    snprintf(text, sizeof(text), "ticks run late back to back: %ld", missedTicks);
+    line(text);
+}
+
+void putVarint(std::vector<unsigned char>& bytes, unsigned long long value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<unsigned char>(value));
+}
+
+bool getVarint(const std::vector<unsigned char>& bytes, size_t& pos, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; pos < bytes.size() && shift < 64; shift += 7) {
+        unsigned char byte = bytes[pos++];
+        value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void recordEvent(int kind) {
+    putVarint(recording, static_cast<unsigned long long>(tickCount - lastEventTick) << 3 | kind);
+    lastEventTick = tickCount;
+}
+
+//end the recording of the game that just finished and write it to 'path'
+bool saveRecording(const char* path) {
+    recordEvent(quitGame ? END_QUIT : END_GAME_OVER);
+    putVarint(recording, score);
+    unsigned char header[13];
+    memcpy(header, REPLAY_MAGIC, 4);
+    header[4] = REPLAY_VERSION;
+    for (int i = 0; i < 4; ++i) header[5 + i] = static_cast<unsigned char>(gameSeed >> (8 * i));
+    for (int i = 0; i < 2; ++i) header[9 + i] = static_cast<unsigned char>(boardRows >> (8 * i));
+    for (int i = 0; i < 2; ++i) header[11 + i] = static_cast<unsigned char>(boardCols >> (8 * i));
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool written = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                   fwrite(recording.data(), 1, recording.size(), file) == recording.size();
+    return fclose(file) == 0 && written;
+}
+
+//read a replay, false with 'error' set if it isn't one
+bool loadReplay(const char* path, Replay& replay, const char*& error) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        error = "can't open the replay";
+        return false;
+    }
+    std::vector<unsigned char> bytes;
+    unsigned char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+    fclose(file);
+    if (bytes.size() < 13 || memcmp(bytes.data(), REPLAY_MAGIC, 4) != 0 || bytes[4] != REPLAY_VERSION) {
+        error = "not a replay file";
+        return false;
+    }
+    replay.seed = bytes[5] | bytes[6] << 8 | bytes[7] << 16 | static_cast<unsigned>(bytes[8]) << 24;
+    replay.rows = bytes[9] | bytes[10] << 8;
+    replay.cols = bytes[11] | bytes[12] << 8;
+    if (!boardSizeOk(replay.rows, replay.cols)) {
+        error = "not a replay file";
+        return false;
+    }
+    replay.events.clear();
+    size_t pos = 13;
+    long tick = 0;
+    unsigned long long value;
+    while (getVarint(bytes, pos, value)) {
+        tick += static_cast<long>(value >> 3);
+        int kind = static_cast<int>(value & 7);
+        if (kind > END_QUIT) break;
+        replay.events.push_back({tick, kind});
+        if (kind >= END_GAME_OVER) {
+            unsigned long long finalScore;
+            if (!getVarint(bytes, pos, finalScore)) break;
+            replay.score = static_cast<long>(finalScore);
+            return true;
+        }
+    }
+    error = "the replay is cut short";
+    return false;
+}
+
+//before an update() during playback: turn where the recording turned, and
+//stop where it stopped. true while there is more to play
+bool applyPlayback() {
+    while (playbackEvent < playback->events.size() && playback->events[playbackEvent].tick == tickCount) {
+        const ReplayEvent& event = playback->events[playbackEvent];
+        if (event.kind >= END_GAME_OVER) return false;
+        direction = static_cast<Direction>(event.kind);
+        playbackEvent++;
+    }
+    return true;
+}
+
+//build the tree for the current board, unless it's there already: every
+//block column hangs off the top block row. the snake is on rows 1 .. rows - 1
+//& columns 1 .. cols - 2, both counts have to be even for the blocks to
+//cover them, false if they aren't
+bool buildTree() {
+    if (treeRows == boardRows && treeCols == boardCols) return !treeEdge.empty();
+    treeRows = boardRows;
+    treeCols = boardCols;
+    treeEdge.clear();
+    int rows = boardRows - 1, cols = boardCols - 2;
+    if (rows % 2 != 0 || cols % 2 != 0) return false;
+    blockRows = rows / 2;
+    blockCols = cols / 2;
+    int blocks = blockRows * blockCols;
+    treeEdge.assign(2 * static_cast<size_t>(blocks), 0);
+    for (int b = 0; b < blocks; ++b) {
+        if (b + 1 < blockCols) treeEdge[2 * b] = 1;
+        if (b + blockCols < blocks) treeEdge[2 * b + 1] = 1;
+    }
+    treeParent.assign(blocks, -1);
+    blockSeen.assign(blocks, 0);
+    foodSide.assign(blocks, 0);
+    blockBody.assign(blocks, 0);
+    size_t cells = static_cast<size_t>(boardRows) * boardCols;
+    cellBlock.assign(cells, -1);
+    cellCorner.assign(cells, 0);
+    cellEdges.assign(cells, -1);
+    for (int y = 1; y < boardRows; ++y) {
+        for (int x = 1; x < boardCols - 1; ++x) {
+            int cell = cellOf(y, x), block = (y - 1) / 2 * blockCols + (x - 1) / 2;
+            int row = block / blockCols, col = block % blockCols;
+            cellBlock[cell] = block;
+            cellCorner[cell] = static_cast<char>((y - 1) % 2 * 2 + (x - 1) % 2);
+            switch (cellCorner[cell]) {
+                case 0: cellEdges[cell] = col > 0 ? 2 * (block - 1) : -1; break;
+                case 1: cellEdges[cell] = row > 0 ? 2 * (block - blockCols) + 1 : -1; break;
+                case 2: cellEdges[cell] = row < blockRows - 1 ? 2 * block + 1 : -1; break;
+                default: cellEdges[cell] = col < blockCols - 1 ? 2 * block : -1; break;
+            }
+        }
+    }
+    routeFrom.assign(2 * cells, -1);
+    routeLength.assign(2 * cells, 0);
+    searchSeen.assign(2 * cells, 0);
+    onRoute.assign(cells, 0);
+    return true;
+}
+
+int blockOf(int cell) {
+    return cellBlock[cell];
+}
+
+//top left cell of a block
+int blockCell(int block) {
+    return cellOf(1 + block / blockCols * 2, 1 + block % blockCols * 2);
+}
+
+bool hasBody(int block) {
+    return blockBody[block] > 0;
+}
+
+//the corner of its block a cell is in: 0 top left, 1 top right, 2 bottom
+//left, 3 bottom right
+int cornerOf(int cell) {
+    return cellCorner[cell];
+}
+
+//the edge that decides where the cycle goes from a cell, -1 on the side of
+//the board: the top left corner crosses left, top right up, bottom left
+//down, bottom right right
+int cellEdge(int cell) {
+    return cellEdges[cell];
+}
+
+//the cell after 'cell' on the cycle, across its edge or on around the block
+int stepFrom(int cell, bool across) {
+    switch (cornerOf(cell)) {
+        case 0: return across ? cell - 1 : cell + boardCols;
+        case 1: return across ? cell - boardCols : cell - 1;
+        case 2: return across ? cell + boardCols : cell + 1;
+        default: return across ? cell + 1 : cell - boardCols;
+    }
+}
+
+int cycleNext(int cell) {
+    int edge = cellEdge(cell);
+    return stepFrom(cell, edge >= 0 && treeEdge[edge]);
+}
+
+//the two cells whose way on an edge decides: bottom right & top left across
+//a right edge, bottom left & top right across a down edge
+void edgeCells(int edge, int& a, int& b) {
+    int near = blockCell(edge / 2);
+    if (edge % 2 == 0) {
+        a = near + boardCols + 1;
+        b = near + 2;
+    } else {
+        a = near + boardCols;
+        b = near + 2 * boardCols + 1;
+    }
+}
+
+//the body depends on the edge: a segment other than the head decides it
+bool pinned(int edge, int head) {
+    int a, b;
+    edgeCells(edge, a, b);
+    return (isOccupied(a) && a != head) || (isOccupied(b) && b != head);
+}
+
+//the edge between two blocks next to each other
+int edgeBetween(int a, int b) {
+    if (a > b) std::swap(a, b);
+    return b == a + 1 ? 2 * a : 2 * a + 1;
+}
+
+//the blocks next to a block & the edges to them, returns how many
+int blockNeighbours(int block, int next[4], int edges[4]) {
+    int row = block / blockCols, col = block % blockCols, count = 0;
+    if (col > 0) {
+        next[count] = block - 1;
+        edges[count++] = 2 * (block - 1);
+    }
+    if (col < blockCols - 1) {
+        next[count] = block + 1;
+        edges[count++] = 2 * block;
+    }
+    if (row > 0) {
+        next[count] = block - blockCols;
+        edges[count++] = 2 * (block - blockCols) + 1;
+    }
+    if (row < blockRows - 1) {
+        next[count] = block + blockCols;
+        edges[count++] = 2 * block + 1;
+    }
+    return count;
+}
+
+//point every block without body towards the body, walking the tree out
+//from the blocks that have some
+void findParents() {
+    std::vector<int>& queue = blockQueue;
+    queue.clear();
+    int stamp = ++blockStamp;
+    for (int b = 0; b < blockRows * blockCols; ++b) {
+        if (!hasBody(b)) continue;
+        blockSeen[b] = stamp;
+        queue.push_back(b);
+    }
+    int next[4], edges[4];
+    for (size_t i = 0; i < queue.size(); ++i) {
+        int count = blockNeighbours(queue[i], next, edges);
+        for (int k = 0; k < count; ++k) {
+            if (!treeEdge[edges[k]] || blockSeen[next[k]] == stamp) continue;
+            blockSeen[next[k]] = stamp;
+            treeParent[next[k]] = queue[i];
+            queue.push_back(next[k]);
+        }
+    }
+}
+
+//the tail left a block: it hangs off the block its last segment moved on to,
+//the one block with body the tree joins it to
+void leaveBlock(int block) {
+    int next[4], edges[4];
+    int count = blockNeighbours(block, next, edges);
+    for (int k = 0; k < count; ++k) {
+        if (treeEdge[edges[k]] && hasBody(next[k])) treeParent[block] = next[k];
+    }
+}
+
+//cutting 'edge' leaves 'child' & the blocks below it without a way to the
+//body. look for a new edge to hang them on by, from one of them to a block
+//outside that neither the body nor the route pins: hangEdge from hangFrom
+//to hangTo. a block without body is outside if going up treeParent from it
+//gets to the body before it gets to one of them; the blocks gone up through
+//are marked with which it was, so no chain is gone up twice. false if none
+//is found, the snake goes around what hangs off the edge then
+bool findHanger(int child, int edge, int head) {
+    std::vector<int>& below = blockQueue;
+    below.assign(1, child);
+    int stamp = ++blockStamp, inside = ++blockStamp, outside = ++blockStamp;
+    blockSeen[child] = stamp;
+    int next[4], edges[4];
+    for (size_t i = 0; i < below.size(); ++i) {
+        int count = blockNeighbours(below[i], next, edges);
+        for (int k = 0; k < count; ++k) {
+            if (edges[k] == edge || blockSeen[next[k]] == stamp) continue;
+            if (treeEdge[edges[k]]) {
+                //may be marked inside already, it still has to be gone through
+                blockSeen[next[k]] = stamp;
+                below.push_back(next[k]);
+                continue;
+            }
+            int a, b;
+            edgeCells(edges[k], a, b);
+            if (pinned(edges[k], head) || onRoute[a] == routeStamp || onRoute[b] == routeStamp) continue;
+            int up = next[k];
+            hangChain.clear();
+            while (!hasBody(up) && blockSeen[up] < stamp) {
+                hangChain.push_back(up);
+                up = treeParent[up];
+            }
+            int mark = hasBody(up) || blockSeen[up] == outside ? outside : inside;
+            for (int block : hangChain) blockSeen[block] = mark;
+            if (mark == inside) continue;
+            hangEdge = edges[k];
+            hangFrom = below[i];
+            hangTo = next[k];
+            return true;
+        }
+    }
+    return false;
+}
+
+//whether a block without body has a neighbour to hang on besides its
+//parent & children, across an edge the body doesn't pin
+bool canHang(int block, int head) {
+    int next[4], edges[4];
+    int count = blockNeighbours(block, next, edges);
+    for (int k = 0; k < count; ++k) {
+        if (!treeEdge[edges[k]] && treeParent[next[k]] != block && !pinned(edges[k], head)) return true;
+    }
+    return false;
+}
+
+//the block a cell's edge leads down to, when the cycle goes from the cell
+//into blocks without body & comes back to the cell's next one in the block,
+//else -1
+int childBelow(int cell) {
+    int edge = cellEdge(cell);
+    if (edge < 0 || !treeEdge[edge]) return -1;
+    int child = blockOf(stepFrom(cell, true));
+    return !hasBody(child) && treeParent[child] == blockOf(cell) ? child : -1;
+}
+
+//whether the cell of a route state goes on across its edge: the edge is
+//there, & isn't the one to the parent of a block the route hung elsewhere
+bool goesAcross(int state) {
+    int cell = state / 2, edge = cellEdge(cell), block = blockOf(cell);
+    if (edge < 0 || !treeEdge[edge]) return false;
+    return !(state & 1) || hasBody(block) || edge != edgeBetween(block, treeParent[block]);
+}
+
+//a short way from the head to the food the cycle can be made to take: every
+//step is one of the two a cell has, & the body mustn't pin the edge that
+//picks it. a block without body is either gone into across the edge to its
+//parent, which leaves it as it is, or across a new edge, which hangs it off
+//the block the route comes from & drops the edge to its parent; that's the
+//bit the route's states have next to the cell (state = 2 * cell + moved).
+//A* over the states with the distance to the food as the estimate; a step
+//keeps the estimated length or adds 2, so two lists of open states do, the
+//one being worked on & the next. gives up after ROUTE_EFFORT states per
+//cell of the distance, false then or if there's no way, else the way is in
+//'route'. it starts at 'start', the head or a cell the cycle gets to from it
+//as it is
+bool findRoute(int head, int start, int target) {
+    Point goal = pointOf(target);
+    auto estimate = [&](int state) {
+        Point p = pointOf(state / 2);
+        return abs(p.y - goal.y) + abs(p.x - goal.x);
+    };
+    openStates[0].assign(1, 2 * start);
+    openStates[1].clear();
+    searchSeen[2 * start] = routeStamp;
+    routeLength[2 * start] = 0;
+    int level = 0, estimated = estimate(2 * start), found = -1;
+    long effort = ROUTE_EFFORT * (estimated + 2L * blockCols);
+    while (found < 0) {
+        if (openStates[level].empty()) {
+            level ^= 1;
+            estimated += 2;
+            if (openStates[level].empty()) return false;
+        }
+        if (--effort < 0) return false;
+        int state = openStates[level].back();
+        openStates[level].pop_back();
+        int length = estimated - estimate(state);
+        if (length != routeLength[state]) continue; //got there shorter since
+        int cell = state / 2, edge = cellEdge(cell);
+        if (cell == target) {
+            found = state;
+            break;
+        }
+        bool linked = goesAcross(state);
+        //a linked edge down to a block without body could be cut, if what
+        //hangs off it can be hung on elsewhere. that's only looked into for
+        //the route found (layCuts), here it's enough that the block has a
+        //neighbour it could hang on
+        bool cut = false;
+        if (linked) {
+            int child = childBelow(cell);
+            cut = child >= 0 && canHang(child, head);
+        }
+        for (int across = 0; across < 2; ++across) {
+            if (across ? edge < 0 : linked && !cut) continue;
+            int next = stepFrom(cell, across), moved = 0;
+            if (isOccupied(next)) continue;
+            if (across && !linked) {
+                //a new edge, only into a block without body: into one with
+                //body it would close a loop through the body
+                if (hasBody(blockOf(next)) || pinned(edge, head)) continue;
+                moved = 1;
+            } else if (!across) {
+                moved = state & 1;
+            }
+            next = 2 * next + moved;
+            if (searchSeen[next] == routeStamp && routeLength[next] <= length + 1) continue;
+            searchSeen[next] = routeStamp;
+            routeLength[next] = length + 1;
+            routeFrom[next] = state;
+            openStates[estimate(next) < estimate(state) ? level : level ^ 1].push_back(next);
+        }
+    }
+    route.clear();
+    routeCuts.clear();
+    for (int state = found; state != 2 * start; state = routeFrom[state]) {
+        int from = routeFrom[state];
+        if (blockOf(from / 2) == blockOf(state / 2) && goesAcross(from)) routeCuts.push_back(from / 2);
+        route.push_back(state / 2);
+    }
+    route.push_back(start);
+    std::reverse(route.begin(), route.end());
+    std::reverse(routeCuts.begin(), routeCuts.end());
+    return true;
+}
+
+//the way the cycle goes from the head to the food as it is, leaving out
+//what hangs below it that doesn't lead to the food: the blocks from the
+//food's up to the body are marked first, the others are cut. into
+//walkRoute & walkCuts, false if it's longer than 'limit' cells
+bool walkCycle(int head, int target, size_t limit) {
+    int stamp = ++blockStamp;
+    for (int block = blockOf(target); !hasBody(block); block = treeParent[block]) blockSeen[block] = stamp;
+    walkRoute.assign(1, head);
+    walkCuts.clear();
+    for (int cell = head; cell != target;) {
+        if (walkRoute.size() > limit) return false;
+        int child = childBelow(cell);
+        if (child >= 0 && blockSeen[child] != stamp) {
+            walkCuts.push_back(cell);
+            cell = stepFrom(cell, false);
+        } else {
+            cell = cycleNext(cell);
+        }
+        walkRoute.push_back(cell);
+    }
+    return true;
+}
+
+//the blocks without body the food's block can be got to from without going
+//through body, the side of the body the food is on. false if the food's
+//block has body
+bool markFoodSide(int target) {
+    int first = blockOf(target);
+    if (hasBody(first)) return false;
+    std::vector<int>& side = blockQueue;
+    side.assign(1, first);
+    foodSide[first] = ++foodStamp;
+    int next[4], edges[4];
+    for (size_t i = 0; i < side.size(); ++i) {
+        int count = blockNeighbours(side[i], next, edges);
+        for (int k = 0; k < count; ++k) {
+            if (foodSide[next[k]] == foodStamp || hasBody(next[k])) continue;
+            foodSide[next[k]] = foodStamp;
+            side.push_back(next[k]);
+        }
+    }
+    return true;
+}
 
-    // Draw the snake's head
-    if (!snake.empty()) {
-        mvaddch(snake.front().y, snake.front().x, 'O'); // 'O' for the head
+//a way to the food in two parts: along the cycle as it is, leaving out what
+//hangs below it, up to the first cell with an edge the body doesn't pin
+//into a block on the food's side, then findRoute from there; the blocks
+//there are free, so findRoute has room to go around. into 'route' &
+//'routeCuts', false if there's no way, or it's longer than 'limit' cells,
+//or the first part gets round to the tail
+bool enterFoodSide(int head, int target, size_t limit) {
+    if (!markFoodSide(target)) return false;
+    walkRoute.assign(1, head);
+    walkCuts.clear();
+    int cell = head;
+    for (;;) {
+        if (walkRoute.size() > limit || (cell != head && isOccupied(cell))) return false;
+        int edge = cellEdge(cell);
+        if (edge >= 0 && foodSide[blockOf(stepFrom(cell, true))] == foodStamp && !pinned(edge, head)) break;
+        int child = childBelow(cell);
+        if (child >= 0) {
+            walkCuts.push_back(cell);
+            cell = stepFrom(cell, false);
+        } else {
+            cell = cycleNext(cell);
+        }
+        walkRoute.push_back(cell);
+    }
+    if (!findRoute(head, cell, target) || walkRoute.size() + route.size() - 2 > limit) return false;
+    walkRoute.insert(walkRoute.end(), route.begin() + 1, route.end());
+    walkCuts.insert(walkCuts.end(), routeCuts.begin(), routeCuts.end());
+    route.swap(walkRoute);
+    routeCuts.swap(walkCuts);
+    return true;
+}
+
+//make the cycle go from the head to 'next', one of the head's two possible
+//successors. a step into another block hangs that block off the head's,
+//which has body so it can't be below it. false if the body pins the edge or
+//there's no such change
+bool takeStep(int head, int next) {
+    if (cycleNext(head) == next) return true;
+    int edge = cellEdge(head), from = blockOf(head), to = blockOf(next);
+    if (from == to || hasBody(to) || pinned(edge, head)) return false;
+    treeEdge[edgeBetween(to, treeParent[to])] = 0;
+    treeEdge[edge] = 1;
+    treeParent[to] = from;
+    return true;
+}
+
+//cut the edge from a cell of the route down to blocks without body, so the
+//route goes on around the cell's block: what's below is hung on elsewhere
+//(findHanger), the blocks from there up to the cut pointing the other way.
+//false if that can't be done
+bool cutBelow(int cell, int head) {
+    int edge = cellEdge(cell), child = childBelow(cell);
+    //an earlier cut may have hung the block the other way round
+    if (child < 0 || pinned(edge, head) || !findHanger(child, edge, head)) return false;
+    treeEdge[edge] = 0;
+    treeEdge[hangEdge] = 1;
+    for (int block = hangFrom, up = hangTo;;) {
+        int old = treeParent[block];
+        treeParent[block] = up;
+        if (block == child) break;
+        up = block;
+        block = old;
+    }
+    return true;
+}
+
+//find a route to the food that just came up, the snake takes it a step a
+//tick: the shorter of enterFoodSide's & the way the cycle already goes, the
+//latter when there's no other, it always gets there
+void planRoute() {
+    int head = segmentAt(0), target = cellOf(food.y, food.x);
+    plannedFood = target;
+    ++routeStamp;
+    bool found = enterFoodSide(head, target, SIZE_MAX);
+    if (walkCycle(head, target, found ? route.size() - 1 : SIZE_MAX)) {
+        route.swap(walkRoute);
+        routeCuts.swap(walkCuts);
+    }
+    for (int cell : route) onRoute[cell] = routeStamp;
+    //before the body gets round to pinning what could hang the blocks they
+    //leave. one that can't be made yet is tried again once the head is there
+    for (int cell : routeCuts) cutBelow(cell, head);
+    routeStep = 0;
+    detouring = false;
+}
+
+//pick the autopilot's next move: the head's successor on the cycle, after
+//bending the cycle onto the route if there is one
+Direction autopilotDirection() {
+    if (tickCount == 0) {
+        //a new game
+        std::fill(blockBody.begin(), blockBody.end(), 0);
+        for (size_t i = 0; i < snakeLength; ++i) blockBody[blockOf(segmentAt(i))]++;
+        findParents();
+        plannedFood = -1;
+    } else {
+        blockBody[blockOf(changes.newHead)]++;
+        if (changes.vacated >= 0 && --blockBody[blockOf(changes.vacated)] == 0) leaveBlock(blockOf(changes.vacated));
+    }
+    if (cellOf(food.y, food.x) != plannedFood || tickCount == replanAt) planRoute();
+    int head = segmentAt(0);
+    if (detouring && head == route[routeStep]) {
+        detouring = false;
+    }
+    if (routeStep >= 0 && !detouring && routeStep + 1 < static_cast<int>(route.size())) {
+        int next = route[routeStep + 1];
+        bool around = route[routeStep] == head && next == stepFrom(head, false) && childBelow(head) >= 0;
+        if (around) cutBelow(head, head);
+        if (route[routeStep] == head && takeStep(head, next)) {
+            routeStep++;
+        } else if (around) {
+            //a cut that can't be made, the cycle comes back to 'next'. the
+            //tail may free what's in the way before then
+            routeStep++;
+            detouring = true;
+            replanAt = tickCount + DETOUR_REPLAN;
+        } else {
+            routeStep = -1;
+            plannedFood = -1; //look again next tick
+        }
     }
+    Point p = pointOf(head), to = pointOf(cycleNext(head));
+    if (to.y < p.y) return UP;
+    if (to.y > p.y) return DOWN;
+    return to.x < p.x ? LEFT : RIGHT;
+}
 
-    // Draw the rest of the snake's body
-    for (size_t i = 1; i < snake.size(); ++i) {
-        mvaddch(snake[i].y, snake[i].x, 'o'); // 'o' for the body
+//what is on board cell (y, x), x < boardCols & y <= boardRows: row boardRows
+//is only there to draw the wall under the bottom row
+chtype cellChar(int y, int x) {
+    bool top = y == 0, bottom = y == boardRows, left = x == 0, right = x == boardCols - 1;
+    if (top || bottom) {
+        if (left) return top ? ACS_ULCORNER : ACS_LLCORNER;
+        if (right) return top ? ACS_URCORNER : ACS_LRCORNER;
+        return ACS_HLINE;
     }
+    if (left || right) return ACS_VLINE;
+    int cell = cellOf(y, x);
+    if (isOccupied(cell)) return cell == segmentAt(0) ? 'O' : 'o'; // 'O' for the head, 'o' for the body
+    if (y == food.y && x == food.x) return '@';
+    return ' ';
+}
+
+//keep the head away from the edges of the screen: once it gets within a
+//quarter of the screen of one, the camera jumps to put it in the middle.
+//jumping instead of scrolling along means the whole screen is redrawn only
+//every so often. true if it moved
+bool updateCamera() {
+    Point head = pointOf(segmentAt(0));
+    int viewRows = LINES, viewCols = COLS;
+    auto follow = [](int camera, int head, int view, int world) {
+        int margin = view / 4;
+        if (head - camera < margin || head - camera > view - 1 - margin) camera = head - view / 2;
+        return std::max(0, std::min(camera, world - view));
+    };
+    int y = follow(cameraY, head.y, viewRows, boardRows + 1);
+    int x = follow(cameraX, head.x, viewCols, boardCols);
+    bool moved = y != cameraY || x != cameraX;
+    cameraY = y;
+    cameraX = x;
+    return moved;
+}
 
-    //draw food
-    mvaddch(food.y, food.x, '@');
+//draw board cell (y, x) where the camera puts it, if that's on the screen
+void drawCell(int y, int x, chtype ch) {
+    int row = y - cameraY, col = x - cameraX;
+    if (row >= 0 && row < LINES && col >= 0 && col < COLS) mvaddch(row, col, ch);
+}
 
-    //display score
+//draw game board and elements, the whole screen: the part of the board the
+//camera looks at. only at the start, when the camera moves, on a resize and
+//when pause or the stats come & go, every other tick uses drawTick()
+void draw() {
+    updateCamera();
+    erase();
+    int rows = std::min(LINES, boardRows + 1 - cameraY);
+    int cols = std::min(COLS, boardCols - cameraX);
+    for (int row = 0; row < rows; ++row) {
+        move(row, 0);
+        for (int col = 0; col < cols; ++col) {
+            addch(cellChar(cameraY + row, cameraX + col));
+        }
+    }
+
+    //display score, on the top row whatever part of the board is there
     mvprintw(0, 3, "Score %d", score);
 
     if (isPaused) {
-        mvprintw(MAX_Y / 2, MAX_X / 2 - 6, "GAME PAUSED");
+        mvprintw(LINES / 2, COLS / 2 - 6, "GAME PAUSED");
+    }
+    if (showStats) {
+        drawStats();
     }
 
     refresh();
+    repaintNeeded = false;
 }
 
+//draw what the last update() changed: the new head, the old head as body,
+//the tail cell left behind, and the food & score after eating. a few cells
+//whatever the length of the snake or the size of the board, and ncurses has
+//only those to send. no refresh(), the caller does that once for all ticks
+//it ran
+void drawTick() {
+    if (!changes.moved) return;
+    Point p = pointOf(changes.oldHead);
+    drawCell(p.y, p.x, 'o');
+    if (changes.vacated >= 0) {
+        p = pointOf(changes.vacated);
+        drawCell(p.y, p.x, ' ');
+    }
+    p = pointOf(changes.newHead);
+    drawCell(p.y, p.x, 'O');
+    if (changes.ate) {
+        drawCell(food.y, food.x, '@');
+        mvprintw(0, 3, "Score %d", score);
+    }
+    changes.moved = false;
+}
 
 //generate food @ random position
 void generateFood() {
-    bool onSnake;
-    do {
-        onSnake = false;
-        food.y = rand() % (MAX_Y - 2) + 1;
-        food.x = rand() % (MAX_X - 2) + 1;
-
-        // check if food is on the snake
-        for (const auto& p : snake) {
-            if (p.y == food.y && p.x == food.x) {
-                onSnake = true;
-                break;
-            }
-        }
-    } while (onSnake);
+    //nowhere left, the snake fills the board
+    if (freeCells.empty()) {
+        gameOver = true;
+        return;
+    }
+    std::uniform_int_distribution<size_t> pick(0, freeCells.size() - 1);
+    food = pointOf(freeCells[pick(rng)]);
 }
 
 //update game state
 void update() {
     if (gameOver) return;
 
+    //the recording only needs the turns, one compare per tick otherwise
+    if (direction != recordedDirection) {
+        recordEvent(direction);
+        recordedDirection = direction;
+    }
+    tickCount++;
+
     //get current head pose
-    Point head = snake.front();
+    Point head = pointOf(segmentAt(0));
 
     //move snake
+    movedDirection = direction;
     switch (direction) {
         case UP:    head.y--; break;
         case DOWN:  head.y++; break;
@@ -102,89 +1024,409 @@ void update() {
     }
 
     //check for collision with walls
-    if (head.y <= 0 || head.y >= MAX_Y || head.x <= 0 || head.x >= MAX_X - 1) {
+    if (head.y <= 0 || head.y >= boardRows || head.x <= 0 || head.x >= boardCols - 1) {
         gameOver = true;
         return;
     }
 
-    //check self collision
-    for (const auto& p : snake) {
-        if (p.y == head.y && p.x == head.x) {
-            gameOver = true;
-            return;
-        }
+    //check self collision, the tail still counts as it hasn't moved yet
+    int cell = cellOf(head.y, head.x);
+    if (isOccupied(cell)) {
+        gameOver = true;
+        return;
     }
 
     //add new head to front of snake
-    snake.insert(snake.begin(), head);
+    changes = {true, segmentAt(0), cell, -1, false};
+    pushHead(cell);
 
     //check if snake eats food
     if (head.y == food.y && head.x == food.x) {
+        changes.ate = true;
         score += 10;
         generateFood();
         if (score % 50 == 0) {
-            usleepDelay -= 10000;
+            tickMicros = std::max(MIN_TICK_MICROS, tickMicros - 10000);
         }
+    } else if (growPending > 0) {
+        growPending--;
     } else {
-        snake.pop_back();
+        changes.vacated = segmentAt(snakeLength - 1);
+        popTail();
     }
 }
 
-//handle user input
+//handle user input, every key that has arrived
 void input() {
-    int ch = getch();
-    switch (ch) {
-        case KEY_UP:    if (direction != DOWN) direction = UP; break;
-        case KEY_DOWN:  if (direction != UP) direction = DOWN; break;
-        case KEY_LEFT:  if (direction != RIGHT) direction = LEFT; break;
-        case KEY_RIGHT: if (direction != LEFT) direction = RIGHT; break;
-        case 'q':       gameOver = true; break;
-        case 'p':       isPaused = !isPaused; break;
+    int ch;
+    while ((ch = getch()) != ERR) {
+        Direction before = direction;
+        //a replay or the autopilot steers itself
+        if ((playback || autopilot) && (ch == KEY_UP || ch == KEY_DOWN || ch == KEY_LEFT || ch == KEY_RIGHT)) continue;
+        switch (ch) {
+            case KEY_UP:    if (movedDirection != DOWN) direction = UP; break;
+            case KEY_DOWN:  if (movedDirection != UP) direction = DOWN; break;
+            case KEY_LEFT:  if (movedDirection != RIGHT) direction = LEFT; break;
+            case KEY_RIGHT: if (movedDirection != LEFT) direction = RIGHT; break;
+            case 'q':       gameOver = true; quitGame = true; break;
+            case 'p':       isPaused = !isPaused; repaintNeeded = true; break;
+            case 'h':       showStats = !showStats; repaintNeeded = true; break;
+            case KEY_RESIZE: repaintNeeded = true; break;
+        }
+        //the first turn since the last move is the one that waits for it
+        if (direction != before && !turnPending) {
+            turnPending = true;
+            turnPressedAt = std::chrono::steady_clock::now();
+        }
     }
 }
 
+//(re)start the tick timer at the current speed, the first tick one period from now
+void armTimer(int timer, std::chrono::steady_clock::time_point& nextTickAt) {
+    int micros = std::max(1, tickMicros / playbackSpeed);
+    itimerspec period = {};
+    period.it_interval.tv_sec = micros / 1000000;
+    period.it_interval.tv_nsec = (micros % 1000000) * 1000L;
+    period.it_value = period.it_interval;
+    nextTickAt = std::chrono::steady_clock::now() + std::chrono::microseconds(micros);
+    timerfd_settime(timer, 0, &period, nullptr);
+}
+
+long microsSince(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+}
+
+//play until the game is over. the board moves on a fixed timestep: a
+//timerfd fires every tickMicros and poll() wakes up for it or for a key,
+//whichever comes first, so keys are handled the moment they arrive and
+//don't push the next tick back
+void playGame(int timer) {
+    const int MAX_CATCH_UP = 5; //ticks run at once after a stall, the rest are dropped
+    std::chrono::steady_clock::time_point nextTickAt;
+    armTimer(timer, nextTickAt);
+    int armedMicros = tickMicros;
+    draw();
+    while (!gameOver) {
+        pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {timer, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) { //a resize, getch has KEY_RESIZE for us
+                input();
+                if (!gameOver && repaintNeeded) draw();
+                continue;
+            }
+            gameOver = true;
+            break;
+        }
+        if (fds[0].revents & POLLIN) {
+            input();
+            if (!gameOver && repaintNeeded) draw(); //pause & stats show right away
+        }
+        if (fds[1].revents & POLLIN) {
+            uint64_t expirations = 0;
+            if (read(timer, &expirations, sizeof(expirations)) != sizeof(expirations) || expirations == 0) continue;
+            auto now = std::chrono::steady_clock::now();
+            record(tickJitter, microsSince(nextTickAt, now));
+            nextTickAt += std::chrono::microseconds(std::max(1, tickMicros / playbackSpeed)) * expirations;
+            missedTicks += expirations - 1;
+            for (uint64_t k = 0; k < std::min<uint64_t>(expirations, MAX_CATCH_UP) && !gameOver; ++k) {
+                if (isPaused) break;
+                if (playback && !applyPlayback()) {
+                    gameOver = true; //the end of the recording
+                    break;
+                }
+                if (autopilot) direction = autopilotDirection();
+                update();
+                //once the camera moves the whole screen changes anyway
+                if (updateCamera()) {
+                    repaintNeeded = true;
+                } else {
+                    drawTick();
+                }
+                if (turnPending) {
+                    record(inputLatency, microsSince(turnPressedAt, now));
+                    turnPending = false;
+                }
+            }
+            if (!gameOver) {
+                //the stats overlay sits on the board, it's redrawn in full while shown
+                if (repaintNeeded || showStats) {
+                    draw();
+                } else {
+                    refresh();
+                }
+                record(renderTime, microsSince(now, std::chrono::steady_clock::now()));
+            }
+            if (tickMicros != armedMicros) { //sped up
+                armTimer(timer, nextTickAt);
+                armedMicros = tickMicros;
+            }
+        }
+    }
+}
+
+//the histograms after the game, on the normal terminal
+void printStats() {
+    auto line = [](const char* text) { printf("%s\n", text); };
+    describe(tickJitter, line);
+    describe(inputLatency, line);
+    describe(renderTime, line);
+    printf("ticks run late back to back: %ld\n", missedTicks);
+}
+
 void resetGame() {
 
-    snake.clear();
+    while (snakeLength > 0) popTail();
     //initial snake position and direction
-    snake.push_back({MAX_Y / 2, MAX_X / 2});
+    pushHead(cellOf(boardRows / 2, boardCols / 2));
     direction = RIGHT;
+    movedDirection = RIGHT;
     score = 0;
     gameOver = false;
     isPaused = false;
-    usleepDelay = 100000;
+    growPending = 0;
+    tickMicros = 100000;
+    turnPending = false;
+    quitGame = false;
+    tickCount = 0;
+    lastEventTick = 0;
+    recordedDirection = direction;
+    recording.clear();
+    rng.seed(gameSeed); //every game has its own seed, so it can be replayed
     //init food
     generateFood();
 }
 
+//which way the benchmark snake goes from 'head': along the rows in a zigzag,
+//then back up the first column, a loop through every cell when the board
+//has an even number of rows to play on
+Direction benchDirection(Point head) {
+    int lastRow = boardRows - 1, lastCol = boardCols - 2;
+    if (head.x == 1) return head.y == 1 ? RIGHT : UP;
+    if ((head.y - 1) % 2 == 0) return head.x < lastCol ? RIGHT : DOWN;
+    if (head.x > 2) return LEFT;
+    return head.y == lastRow ? LEFT : DOWN;
+}
+
+//time update() without ncurses on a rows x cols board, with the snake at
+//a few lengths, to show a tick costs the same however long the snake is.
+//placing food is timed as well, up to a board that is 99% snake
+int runBenchmark(int rows, int cols, unsigned seed) {
+    rows -= (rows - 1) % 2; //the zigzag needs an even number of rows
+    initBoard(rows, cols);
+    gameSeed = seed;
+    resetGame();
+    size_t cells = static_cast<size_t>(rows - 1) * (cols - 2);
+    //about one lap of the board, so the food eaten on the way can't fill it
+    const long TICKS = std::min<long>(4000000, cells);
+    const long PLACEMENTS = 1000000;
+    std::vector<size_t> lengths;
+    for (size_t length = 16; length < cells / 2; length *= 16) lengths.push_back(length);
+    lengths.push_back(cells * 9 / 10);
+    lengths.push_back(cells * 99 / 100);
+    printf("%dx%d board, %ld ticks per length\n", cols, rows, TICKS);
+    for (size_t length : lengths) {
+        //grow to the length, then time ticks at about that length
+        growPending = static_cast<int>(length - std::min(length, snakeLength));
+        while (growPending > 0 && !gameOver) {
+            direction = benchDirection(pointOf(segmentAt(0)));
+            update();
+        }
+        if (gameOver) {
+            printf("the game ended at length %zu\n", snakeLength);
+            return 1;
+        }
+        printf("length %8zu (%4.1f%% of the board): ", snakeLength, 100.0 * snakeLength / cells);
+        if (length < cells / 2) {
+            auto started = std::chrono::steady_clock::now();
+            for (long t = 0; t < TICKS && !gameOver; ++t) {
+                direction = benchDirection(pointOf(segmentAt(0)));
+                update();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+            if (gameOver) {
+                printf("the game ended at length %zu\n", snakeLength);
+                return 1;
+            }
+            printf("%6.1f ns/tick (grew to %zu), ", seconds * 1e9 / TICKS, snakeLength);
+        }
+        auto started = std::chrono::steady_clock::now();
+        for (long i = 0; i < PLACEMENTS; ++i) {
+            generateFood();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        printf("%5.1f ns/food\n", seconds * 1e9 / PLACEMENTS);
+    }
+    return 0;
+}
+
+//re-run a replay as fast as possible and check it ends the way it was recorded
+int verifyReplay(const Replay& replay) {
+    initBoard(replay.rows, replay.cols);
+    gameSeed = replay.seed;
+    resetGame();
+    playback = &replay;
+    playbackEvent = 0;
+    auto started = std::chrono::steady_clock::now();
+    while (!gameOver && applyPlayback()) {
+        update();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    const ReplayEvent& end = replay.events.back();
+    bool endedRight = tickCount == end.tick && gameOver == (end.kind == END_GAME_OVER);
+    printf("seed %u, %dx%d board, %zu events, %ld ticks in %.3f s (%.1f M ticks/s)\n", replay.seed, replay.cols,
+           replay.rows, replay.events.size(), tickCount, seconds, seconds > 0 ? tickCount / seconds / 1e6 : 0.0);
+    printf("recorded: score %ld, %s at tick %ld\n", replay.score,
+           end.kind == END_GAME_OVER ? "game over" : "quit", end.tick);
+    printf("replayed: score %d, %s at tick %ld\n", score, gameOver ? "game over" : "still going", tickCount);
+    bool ok = endedRight && score == replay.score;
+    printf("%s\n", ok ? "OK" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+//let the autopilot play one game as fast as it goes, without ncurses
+int runAutopilot(const char* recordPath) {
+    auto started = std::chrono::steady_clock::now();
+    resetGame();
+    while (!gameOver) {
+        direction = autopilotDirection();
+        update();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    bool filled = freeCells.empty();
+    printf("seed %u, %dx%d board, autopilot %s after %ld ticks in %.2f s (%.1f M ticks/s)\n", gameSeed, boardCols,
+           boardRows, filled ? "filled the board" : "crashed", tickCount, seconds,
+           seconds > 0 ? tickCount / seconds / 1e6 : 0.0);
+    printf("score %d, length %zu of %d cells the snake can be on\n", score, snakeLength, (boardRows - 1) * (boardCols - 2));
+    if (recordPath && !saveRecording(recordPath)) {
+        std::cerr << recordPath << ": couldn't write the recording" << std::endl;
+        return 1;
+    }
+    return filled ? 0 : 1;
+}
+
 //main loop
-int main() {
+//usage: ncurses-snek [--seed n] [--board rows cols] [--record file] [--autopilot [--headless]]
+//                    [--bench [rows] [cols]]
+//       ncurses-snek --replay file [--speed n] | --verify file
+//without --seed every run places different food. --board sets the size of
+//the board, up to 4096x4096, the screen scrolls to follow the snake. --record writes each
+//game to 'file' when it ends (the last one is kept), --replay plays one
+//back n times as fast as it was played, --verify checks it without drawing.
+//--autopilot plays by itself, with --headless as fast as it can until the
+//board is full
+int main(int argc, char* argv[]) {
+    unsigned seed = std::random_device()();
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    bool verify = false;
+    bool headless = false;
+    int boardRowsWanted = DEFAULT_ROWS;
+    int boardColsWanted = DEFAULT_COLS;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--board") == 0 && i + 2 < argc) {
+            boardRowsWanted = atoi(argv[++i]);
+            boardColsWanted = atoi(argv[++i]);
+            if (!boardSizeOk(boardRowsWanted, boardColsWanted)) {
+                std::cerr << "The board must be 4 rows by 5 columns to 4096 by 4096." << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if ((strcmp(argv[i], "--replay") == 0 || strcmp(argv[i], "--verify") == 0) && i + 1 < argc) {
+            verify = strcmp(argv[i], "--verify") == 0;
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--autopilot") == 0) {
+            autopilot = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            playbackSpeed = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            int rows = i + 1 < argc ? atoi(argv[i + 1]) : 2048;
+            int cols = i + 2 < argc ? atoi(argv[i + 2]) : 2048;
+            if (rows < 4 || cols < 5) {
+                std::cerr << "The board must be at least 4 rows by 5 columns." << std::endl;
+                return 1;
+            }
+            return runBenchmark(rows, cols, seed);
+        }
+    }
+
+    Replay replay;
+    if (replayPath) {
+        const char* error = nullptr;
+        if (!loadReplay(replayPath, replay, error)) {
+            std::cerr << replayPath << ": " << error << std::endl;
+            return 1;
+        }
+        if (verify) {
+            return verifyReplay(replay);
+        }
+    }
+
+    initBoard(replayPath ? replay.rows : boardRowsWanted, replayPath ? replay.cols : boardColsWanted);
+    if (replayPath) {
+        autopilot = false; //the replay steers
+    } else if (autopilot && !buildTree()) {
+        std::cerr << "The autopilot needs an even number of rows and columns inside the walls "
+                     "(rows - 1 and cols - 2)." << std::endl;
+        return 1;
+    }
+    if (headless) {
+        if (!autopilot) {
+            std::cerr << "--headless only goes with --autopilot." << std::endl;
+            return 1;
+        }
+        gameSeed = seed;
+        return runAutopilot(recordPath);
+    }
     setup();
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer < 0) {
+        endwin();
+        perror("timerfd_create");
+        return 1;
+    }
+
+    if (replayPath) {
+        gameSeed = replay.seed;
+        resetGame();
+        playback = &replay;
+        playGame(timer);
+        timeout(-1);
+        mvprintw(LINES / 2, COLS / 2 - 15, " Replay over, score %d of %ld ", score, replay.score);
+        refresh();
+        getch();
+        endwin();
+        close(timer);
+        return 0;
+    }
+
     bool playing = true;
+    bool recordFailed = false;
+    unsigned games = 0;
 
     while (playing) {
         //function to reset variables and init new game
+        gameSeed = seed + games++;
         resetGame();
 
 
         //main loop
-        while (!gameOver) {
-            draw();
-            input();
-
-            if (!isPaused) {
-                update();
-            }
-
-            usleep(usleepDelay);
+        playGame(timer);
+        if (recordPath && !saveRecording(recordPath)) {
+            recordFailed = true;
         }
 
+        timeout(-1); //wait for the choice
         bool choiceMade = false;
         while (!choiceMade) {
             //game over screen
             clear();
-            mvprintw(MAX_Y / 2, MAX_X / 2 - 10, "Game Over ! Final Score : %d", score);
-            mvprintw(MAX_Y / 2, MAX_X / 2 - 15, "Press 'r' to restart or 'q' to quit");
+            mvprintw(LINES / 2, COLS / 2 - 10, "Game Over ! Final Score : %d", score);
+            mvprintw(LINES / 2, COLS / 2 - 15, "Press 'r' to restart or 'q' to quit");
             refresh();
 
             int ch = getch();
@@ -196,9 +1438,16 @@ int main() {
                 choiceMade = true;
             }
         }
+        timeout(0);
     }
     //end ncurses mode
     endwin();
+    close(timer);
+    printStats();
+    if (recordFailed) {
+        std::cerr << recordPath << ": couldn't write the recording" << std::endl;
+        return 1;
+    }
     return 0;
 }
 
@@ -4,6 +4,11 @@
 #include <thread>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h> // for write()
 
 // ANSI escape codes for terminal manipulation
 // These codes are a standard way to control the cursor and colors in a Unix terminal.
@@ -41,25 +46,86 @@ struct Point {
     int y;
 };
 
-// Function to clear the terminal screen using ANSI escape codes.
-void clearScreen() {
-    std::cout << CLEAR_SCREEN << CURSOR_HOME;
+// The whole frame is built in this buffer and sent to the terminal with one
+// write(), instead of one stream operation (and an endl flush) per character.
+// The buffer is sized for the worst possible frame once, so drawing never
+// allocates.
+struct FrameBuffer {
+    std::vector<char> bytes;
+    size_t used = 0;
+};
+
+// Renderer cost, so it can be compared against the 200 ms tick.
+struct FrameStats {
+    long frames = 0;
+    size_t lastBytes = 0;
+    double lastMicros = 0;
+    size_t totalBytes = 0;
+    double totalMicros = 0;
+};
+
+// Which color a cell is drawn in. Neighbouring cells of the same color share
+// one escape sequence.
+enum CellColor { PLAIN, SNAKE_COLOR, FOOD_COLOR };
+
+const char* BORDER_LINE = "--------------------\n";
+const size_t STATUS_BYTES = 256; // room for the text lines under the world
+
+// Bytes needed for the biggest frame of a world this size: every cell
+// switching color (5 byte escape + the char), plus the borders & status.
+size_t frameCapacity(int width, int height) {
+    size_t row = 2 + width * (sizeof(GREEN_TEXT) - 1 + 1) + (sizeof(RESET_COLOR) - 1) + 3;
+    return sizeof(CLEAR_SCREEN CURSOR_HOME) + 2 * std::strlen(BORDER_LINE) + height * row + STATUS_BYTES;
+}
+
+void appendBytes(FrameBuffer& frame, const char* text, size_t length) {
+    length = std::min(length, frame.bytes.size() - frame.used); // can't happen, see frameCapacity
+    std::memcpy(frame.bytes.data() + frame.used, text, length);
+    frame.used += length;
+}
+
+void appendText(FrameBuffer& frame, const char* text) {
+    appendBytes(frame, text, std::strlen(text));
+}
+
+// switch the terminal to 'color' if it isn't in it already
+void setColor(FrameBuffer& frame, CellColor& current, CellColor color) {
+    if (color == current) return;
+    appendText(frame, color == SNAKE_COLOR ? GREEN_TEXT : color == FOOD_COLOR ? RED_TEXT : RESET_COLOR);
+    current = color;
+}
+
+// hand the finished frame to the terminal
+void flushFrame(const FrameBuffer& frame) {
+    size_t done = 0;
+    while (done < frame.used) {
+        ssize_t n = write(STDOUT_FILENO, frame.bytes.data() + done, frame.used - done);
+        if (n <= 0) return; // nothing sensible to do if the terminal went away
+        done += n;
+    }
 }
 
 // Function to draw the game world, including the snake and food.
-void drawWorld(const std::vector<std::vector<char>>& world, const Point& snakePos) {
-    clearScreen(); // Always clear the screen before redrawing to prevent flickering
+// 'message' is an extra line for things that just happened, or nullptr.
+void drawWorld(FrameBuffer& frame, FrameStats& stats, const std::vector<std::vector<char>>& world,
+               const Point& snakePos, const char* message) {
+    auto started = std::chrono::steady_clock::now();
+    frame.used = 0;
+    // Always clear the screen before redrawing to prevent flickering
+    appendText(frame, CLEAR_SCREEN CURSOR_HOME);
 
     // Print the border of the world.
-    std::cout << "--------------------" << std::endl;
+    appendText(frame, BORDER_LINE);
 
     // Loop through each row and column of our 2D world array.
-    for (size_t y = 0; y < world.size(); ++y) {
-        std::cout << "| "; // Left border
+    for (int y = 0; y < static_cast<int>(world.size()); ++y) {
+        appendText(frame, "| "); // Left border
+        CellColor color = PLAIN;
 
         // Loop through each character in the row.
-        for (size_t x = 0; x < world[y].size(); ++x) {
-            bool isSnake = false;
+        for (int x = 0; x < static_cast<int>(world[y].size()); ++x) {
+            char cell = world[y][x];
+            CellColor cellColor = cell == FOOD_CHAR ? FOOD_COLOR : PLAIN;
             // Check if the current position (x, y) is part of the snake.
             // We use the snake's top-left corner (snakePos) and its dimensions
             // to check if a character should be drawn.
@@ -68,24 +134,37 @@ void drawWorld(const std::vector<std::vector<char>>& world, const Point& snakePo
                 // Get the corresponding character from our SNAKE_BODY array.
                 char snakeChar = SNAKE_BODY[y - snakePos.y][x - snakePos.x];
                 if (snakeChar != ' ') {
-                    std::cout << GREEN_TEXT << snakeChar << RESET_COLOR;
-                    isSnake = true;
+                    cell = snakeChar;
+                    cellColor = SNAKE_COLOR;
                 }
             }
-            // If the position is not part of the snake, draw the world character.
-            if (!isSnake) {
-                if (world[y][x] == FOOD_CHAR) {
-                    // If the character is food, make it red.
-                    std::cout << RED_TEXT << world[y][x] << RESET_COLOR;
-                } else {
-                    std::cout << world[y][x];
-                }
+            // Blanks look the same in any color, so they don't break a run.
+            if (cell != ' ') {
+                setColor(frame, color, cellColor);
             }
+            appendBytes(frame, &cell, 1);
         }
-        std::cout << " |" << std::endl; // Right border
+        setColor(frame, color, PLAIN);
+        appendText(frame, " |\n"); // Right border
     }
-    std::cout << "--------------------" << std::endl;
-    std::cout << "Snake position: (" << snakePos.x << ", " << snakePos.y << ")" << std::endl;
+    appendText(frame, BORDER_LINE);
+
+    // The numbers are for the previous frame, this one isn't finished yet.
+    char status[STATUS_BYTES];
+    int length = std::snprintf(status, sizeof(status),
+        "Snake position: (%d, %d)\nFrame: %zu bytes in %.1f us, average %.0f bytes in %.1f us (tick is 200000 us)\n%s%s",
+        snakePos.x, snakePos.y, stats.lastBytes, stats.lastMicros,
+        stats.frames ? double(stats.totalBytes) / stats.frames : 0.0,
+        stats.frames ? stats.totalMicros / stats.frames : 0.0,
+        message ? message : "", message ? "\n" : "");
+    appendBytes(frame, status, std::min<size_t>(std::max(length, 0), sizeof(status) - 1));
+
+    flushFrame(frame);
+    stats.frames++;
+    stats.lastBytes = frame.used;
+    stats.lastMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+    stats.totalBytes += stats.lastBytes;
+    stats.totalMicros += stats.lastMicros;
 }
 
 // Function to find the nearest food item to the snake.
@@ -136,7 +215,263 @@ Point getNextMove(const Point& snakePos, const Point& foodPos) {
     return nextPos;
 }
 
-int main() {
+
+// A batch of independent games stepped in lockstep, for training & evaluating
+// agents from code. Each game is the world of main() without the drawing:
+// the snake's position in a width x height world with FOOD_COUNT food, and
+// the agent picks the move instead of getNextMove. The state is stored as
+// structure-of-arrays, one array per field with game i at index i (food k of
+// game i at k * count + i), so a step is a handful of flat loops over the
+// whole batch with no branches the compiler can't turn into selects, and it
+// vectorizes them. Build with -DSNEK_LIBRARY to leave out main() and include
+// this file from other code.
+
+// The moves an agent can make, one byte per game.
+enum Action { MOVE_RIGHT, MOVE_LEFT, MOVE_DOWN, MOVE_UP, ACTION_COUNT };
+
+// What the agent sees. Feature f of game i is at observations[f * count + i].
+// Positions & offsets are in world widths/heights, so they're about -1..1.
+enum ObservationFeature { OBS_X, OBS_Y, OBS_FOOD_DX, OBS_FOOD_DY, OBS_FOOD_LEFT, OBS_SIZE };
+
+const float REWARD_FOOD = 1.0f;   // for eating food
+const float REWARD_WALL = -1.0f;  // for running into the border, which ends the game
+const float REWARD_STEP = -0.01f; // every step, so dawdling doesn't pay
+const int MAX_ENV_SIDE = 4096;
+// Eaten food is moved here, further than any real food. Small enough that a
+// squared distance to it still fits an int.
+const int NO_FOOD = 4 * MAX_ENV_SIDE;
+
+struct EnvBatch {
+    int count = 0;
+    int width = 0;
+    int height = 0;
+    int maxSteps = 0;  // a game that lasts this long is done as well
+    std::vector<int> x, y;
+    std::vector<int> foodX, foodY;
+    std::vector<int> foodLeft;
+    std::vector<int> steps;
+    std::vector<unsigned> rng; // xorshift state of each game, so resets don't depend on the others
+    std::vector<int> nearest, nearestDx, nearestDy; // scratch for observe()
+    // written by every step
+    std::vector<float> observations;
+    std::vector<float> rewards;
+    std::vector<unsigned char> dones;
+    long episodes = 0; // games finished so far
+};
+
+// What stepBatch returns, pointing into the batch. Valid until the next step.
+struct StepResult {
+    const float* observations; // OBS_SIZE * count, feature-major as above
+    const float* rewards;      // count
+    const unsigned char* dones; // count, 1 if the game ended on this step
+};
+
+unsigned nextRandom(unsigned& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// a random number in [0, range)
+int randomBelow(unsigned& state, int range) {
+    return static_cast<int>((static_cast<unsigned long long>(nextRandom(state)) * range) >> 32);
+}
+
+// Start game i over: the snake and the food at random spots. Only writes
+// into the arrays, so it never allocates.
+void resetGame(EnvBatch& batch, int i) {
+    unsigned& state = batch.rng[i];
+    batch.x[i] = randomBelow(state, batch.width);
+    batch.y[i] = randomBelow(state, batch.height);
+    for (int k = 0; k < FOOD_COUNT; ++k) {
+        int fx, fy;
+        do { // not under the snake
+            fx = randomBelow(state, batch.width);
+            fy = randomBelow(state, batch.height);
+        } while (fx == batch.x[i] && fy == batch.y[i]);
+        batch.foodX[k * batch.count + i] = fx;
+        batch.foodY[k * batch.count + i] = fy;
+    }
+    batch.foodLeft[i] = FOOD_COUNT;
+    batch.steps[i] = 0;
+}
+
+// Fill in the observations from the state.
+void observe(EnvBatch& batch) {
+    const int n = batch.count;
+    const int* x = batch.x.data();
+    const int* y = batch.y.data();
+    int* nearest = batch.nearest.data();
+    int* nearestDx = batch.nearestDx.data();
+    int* nearestDy = batch.nearestDy.data();
+    for (int i = 0; i < n; ++i) nearest[i] = 0x7fffffff;
+    // nearest food like findNearestFood, squared distances so no sqrt
+    for (int k = 0; k < FOOD_COUNT; ++k) {
+        const int* foodX = batch.foodX.data() + k * n;
+        const int* foodY = batch.foodY.data() + k * n;
+        for (int i = 0; i < n; ++i) {
+            int dx = foodX[i] - x[i], dy = foodY[i] - y[i];
+            int distance = dx * dx + dy * dy;
+            bool closer = distance < nearest[i];
+            nearest[i] = closer ? distance : nearest[i];
+            nearestDx[i] = closer ? dx : nearestDx[i];
+            nearestDy[i] = closer ? dy : nearestDy[i];
+        }
+    }
+    float* obs = batch.observations.data();
+    const float scaleX = 1.0f / batch.width, scaleY = 1.0f / batch.height;
+    for (int i = 0; i < n; ++i) {
+        obs[OBS_X * n + i] = x[i] * scaleX;
+        obs[OBS_Y * n + i] = y[i] * scaleY;
+        obs[OBS_FOOD_DX * n + i] = nearestDx[i] * scaleX;
+        obs[OBS_FOOD_DY * n + i] = nearestDy[i] * scaleY;
+        obs[OBS_FOOD_LEFT * n + i] = batch.foodLeft[i] * (1.0f / FOOD_COUNT);
+    }
+}
+
+// Set up 'count' games and start them all. This is the only place the
+// batch allocates; each game's random numbers come from 'seed' and its index.
+StepResult initBatch(EnvBatch& batch, int count, int width, int height, int maxSteps, unsigned seed) {
+    batch.count = count;
+    // at least two cells, or resetGame finds no spot for food beside the snake
+    batch.width = std::max(2, std::min(width, MAX_ENV_SIDE));
+    batch.height = std::max(1, std::min(height, MAX_ENV_SIDE));
+    batch.maxSteps = maxSteps;
+    for (std::vector<int>* field : {&batch.x, &batch.y, &batch.foodLeft, &batch.steps,
+                                    &batch.nearest, &batch.nearestDx, &batch.nearestDy}) {
+        field->assign(count, 0);
+    }
+    batch.foodX.assign(static_cast<size_t>(count) * FOOD_COUNT, 0);
+    batch.foodY.assign(static_cast<size_t>(count) * FOOD_COUNT, 0);
+    batch.rng.resize(count);
+    for (int i = 0; i < count; ++i) {
+        // splitmix the index so neighbouring games don't start alike; xorshift must not start at 0
+        unsigned long long z = seed + 0x9e3779b97f4a7c15ull * (i + 1);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        batch.rng[i] = static_cast<unsigned>(z ^ (z >> 31)) | 1;
+    }
+    batch.observations.assign(static_cast<size_t>(count) * OBS_SIZE, 0.0f);
+    batch.rewards.assign(count, 0.0f);
+    batch.dones.assign(count, 0);
+    batch.episodes = 0;
+    for (int i = 0; i < count; ++i) resetGame(batch, i);
+    observe(batch);
+    return {batch.observations.data(), batch.rewards.data(), batch.dones.data()};
+}
+
+// Advance every game by one move, actions[i] is the move of game i. A game
+// ends when the snake runs into the border (it stays where it was), all its
+// food is eaten or it has lasted maxSteps. A finished game is started over
+// right away, so its observation is already the first one of the new game,
+// while its reward & done flag still belong to the step that ended the old one.
+StepResult stepBatch(EnvBatch& batch, const unsigned char* actions) {
+    const int n = batch.count;
+    const int width = batch.width, height = batch.height;
+    int* x = batch.x.data();
+    int* y = batch.y.data();
+    int* foodLeft = batch.foodLeft.data();
+    int* steps = batch.steps.data();
+    float* rewards = batch.rewards.data();
+    unsigned char* dones = batch.dones.data();
+
+    for (int i = 0; i < n; ++i) {
+        int action = actions[i];
+        int nx = x[i] + (action == MOVE_RIGHT) - (action == MOVE_LEFT);
+        int ny = y[i] + (action == MOVE_DOWN) - (action == MOVE_UP);
+        bool wall = (nx < 0) | (nx >= width) | (ny < 0) | (ny >= height);
+        x[i] = wall ? x[i] : nx;
+        y[i] = wall ? y[i] : ny;
+        rewards[i] = REWARD_STEP + (wall ? REWARD_WALL : 0.0f);
+        dones[i] = wall;
+        steps[i]++;
+    }
+    for (int k = 0; k < FOOD_COUNT; ++k) {
+        int* foodX = batch.foodX.data() + k * n;
+        int* foodY = batch.foodY.data() + k * n;
+        for (int i = 0; i < n; ++i) {
+            bool eaten = (foodX[i] == x[i]) & (foodY[i] == y[i]);
+            foodX[i] = eaten ? NO_FOOD : foodX[i];
+            foodY[i] = eaten ? NO_FOOD : foodY[i];
+            rewards[i] += eaten ? REWARD_FOOD : 0.0f;
+            foodLeft[i] -= eaten;
+        }
+    }
+    int finished = 0;
+    for (int i = 0; i < n; ++i) {
+        dones[i] |= (foodLeft[i] == 0) | (steps[i] >= batch.maxSteps);
+        finished += dones[i];
+    }
+    // the rare finished games are started over one by one
+    if (finished > 0) {
+        for (int i = 0; i < n; ++i) {
+            if (dones[i]) resetGame(batch, i);
+        }
+        batch.episodes += finished;
+    }
+    observe(batch);
+    return {batch.observations.data(), batch.rewards.data(), dones};
+}
+
+#ifndef SNEK_LIBRARY
+
+// Step 'games' games for 'steps' steps with two agents and print the
+// env-steps per second: one that moves at random (the moves are drawn up
+// front, so only the environment is timed) and one that does what
+// getNextMove does with the observation.
+int runEnvBenchmark(int games, int steps) {
+    const int WIDTH = 20, HEIGHT = 10, MAX_STEPS = 200;
+    EnvBatch batch;
+    std::vector<unsigned char> actions(static_cast<size_t>(games) * 64);
+    unsigned state = 12345;
+    for (unsigned char& action : actions) action = static_cast<unsigned char>(randomBelow(state, ACTION_COUNT));
+
+    std::printf("%d games of %dx%d with %d food, %d steps each\n", games, WIDTH, HEIGHT, FOOD_COUNT, steps);
+    for (int agent = 0; agent < 2; ++agent) {
+        StepResult result = initBatch(batch, games, WIDTH, HEIGHT, MAX_STEPS, 1);
+        std::vector<unsigned char> greedy(games);
+        double totalReward = 0;
+        auto started = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; ++step) {
+            const unsigned char* chosen;
+            if (agent == 0) {
+                chosen = actions.data() + static_cast<size_t>(step % 64) * games;
+            } else {
+                const float* dx = result.observations + OBS_FOOD_DX * games;
+                const float* dy = result.observations + OBS_FOOD_DY * games;
+                for (int i = 0; i < games; ++i) {
+                    // x first, then y, like getNextMove
+                    greedy[i] = dx[i] > 0 ? MOVE_RIGHT : dx[i] < 0 ? MOVE_LEFT : dy[i] > 0 ? MOVE_DOWN : MOVE_UP;
+                }
+                chosen = greedy.data();
+            }
+            result = stepBatch(batch, chosen);
+            float stepReward = 0;
+            for (int i = 0; i < games; ++i) stepReward += result.rewards[i];
+            totalReward += stepReward;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        double envSteps = double(games) * steps;
+        std::printf("%-7s %.0f env-steps in %.3f s: %.1f M env-steps/s, %ld games finished, %.2f reward per game\n",
+                    agent == 0 ? "random:" : "greedy:", envSteps, seconds, envSteps / seconds / 1e6,
+                    batch.episodes, batch.episodes ? totalReward / batch.episodes : 0.0);
+    }
+    return 0;
+}
+
+// usage: snek [--bench [games] [steps]]
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench") == 0) {
+        int games = argc > 2 ? std::atoi(argv[2]) : 4096;
+        int steps = argc > 3 ? std::atoi(argv[3]) : 2000;
+        if (games < 1 || steps < 1) {
+            std::cerr << "usage: snek --bench [games] [steps]" << std::endl;
+            return 1;
+        }
+        return runEnvBenchmark(games, steps);
+    }
+
     // Define the dimensions of our game world.
     const int WORLD_WIDTH = 20;
     const int WORLD_HEIGHT = 10;
@@ -155,6 +490,11 @@ int main() {
     // Set the initial position of the snake.
     Point snakePosition = {1, 1};
 
+    // Allocate the frame buffer once, big enough for any frame of this world.
+    FrameBuffer frame;
+    frame.bytes.resize(frameCapacity(WORLD_WIDTH, WORLD_HEIGHT));
+    FrameStats stats;
+
     // The main game loop. This runs indefinitely until the user closes the program.
     while (true) {
         // Find the nearest food item for the snake to chase.
@@ -166,6 +506,8 @@ int main() {
         // Update the snake's position.
         snakePosition = nextPosition;
 
+        const char* message = nullptr;
+
         // Check if the snake has "eaten" the food.
         // We'll consider it eaten if the snake's head (top-left corner) is on the food's location.
         // This is a simple collision detection. We can make it more sophisticated later.
@@ -175,11 +517,11 @@ int main() {
             
             // Remove the food from the world.
             world[foodLocation.y][foodLocation.x] = ' ';
-            std::cout << "The snake ate the food! It will now find the next one." << std::endl;
+            message = "The snake ate the food! It will now find the next one.";
         }
 
         // Draw the updated world.
-        drawWorld(world, snakePosition);
+        drawWorld(frame, stats, world, snakePosition, message);
 
         // Pause for a short duration to control the speed of the animation.
         std::this_thread::sleep_for(std::chrono::milliseconds(200));
@@ -187,3 +529,5 @@ int main() {
 
     return 0;
 }
+
+#endif // SNEK_LIBRARY
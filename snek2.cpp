@@ -5,6 +5,16 @@
 #include <chrono>
 #include <cmath>
 #include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <unistd.h> // for write()
 
 // ANSI escape codes for terminal manipulation
 // These codes are a standard way to control the cursor and colors in a Unix terminal.
@@ -26,64 +36,301 @@ struct Point {
     int y;
 };
 
-// Function to clear the terminal screen using ANSI escape codes.
-void clearScreen() {
-    std::cout << CLEAR_SCREEN << CURSOR_HOME;
+// The game world as one contiguous grid, row after row. cells[y * width + x]
+// is what lies on the ground there (food or nothing), the snake is not in it.
+struct World {
+    int width;
+    int height;
+    std::vector<char> cells;
+};
+
+// Which snake covers each cell, same layout as World::cells. It is kept up
+// to date as the snakes move, so drawing can put them on top of the world
+// while printing instead of copying the world to draw them into.
+struct SnakeGrid {
+    std::vector<unsigned short> segments; // snake segments in the cell
+    // Every snake moves exactly one cell per tick, so the segment that
+    // entered a cell at tick t is now (tick - t) segments behind its head.
+    // Together with the length of the owner that tells the planner when the
+    // cell will be free again.
+    std::vector<unsigned> lastEntry;
+    std::vector<int> owner; // snake of the newest segment in the cell
+    unsigned tick = 0;
+    size_t occupied = 0; // cells with at least one segment
+};
+
+// One snake in the world.
+struct Snake {
+    std::vector<Point> body; // head first, empty while waiting to respawn
+    long foodEaten = 0;
+};
+
+// Scratch space for the path planner, sized to the world once and reused
+// every tick. Instead of clearing 'visited' before each search, a search
+// bumps 'generation' and a cell counts as visited only if it holds the
+// current generation; the low 2 bits say which way the search came in.
+struct Planner {
+    std::vector<unsigned> visited;
+    std::vector<int> current;   // cells to expand at the current f = g + h
+    std::vector<int> next;      // cells for f + 2
+    unsigned generation = 0;
+    long searches = 0;
+    long expanded = 0;
+};
+
+// Where the food is, for nearest-food queries without scanning the world.
+// The world is cut into square buckets of bucketSize cells, each bucket has a
+// linked list of the food in it. Items come from a pool that is allocated
+// once, so adding & eating food doesn't allocate. A query looks at the
+// buckets in growing rings around the head and stops as soon as the next
+// ring can't hold anything closer, so with the bucket size picked for about
+// one food per bucket it touches a handful of buckets, whatever the world size.
+struct FoodItem {
+    Point position;
+    int next; // next item in the same bucket (or the free list), -1 = end
+};
+
+struct FoodIndex {
+    int bucketSize;
+    int bucketsX;
+    int bucketsY;
+    std::vector<int> bucketHead; // first item of each bucket, -1 = empty
+    std::vector<FoodItem> items;
+    int freeItem = -1;
+    size_t count = 0;
+};
+
+// Every heap allocation goes through the operator new below and is counted,
+// so the main loop can check that a frame allocates nothing.
+static size_t allocationCount = 0;
+
+void* operator new(size_t size) {
+    allocationCount++;
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
 }
 
-// Function to draw the game world, including the snake and food.
-// Now takes a vector of points to represent the entire snake body.
-void drawWorld(const std::vector<std::vector<char>>& world, const std::vector<Point>& snakeBody) {
-    clearScreen(); // Always clear the screen before redrawing to prevent flickering
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
 
-    // Create a temporary world to draw the snake on top of the food.
-    std::vector<std::vector<char>> displayWorld = world;
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
 
-    // Draw the snake body.
-    if (!snakeBody.empty()) {
-        // Draw the head first.
-        displayWorld[snakeBody[0].y][snakeBody[0].x] = SNAKE_HEAD_CHAR;
+// The whole frame is built in this buffer and sent with one write(). It is
+// sized for the worst possible frame up front, so drawing never allocates.
+struct FrameBuffer {
+    std::vector<char> bytes;
+    size_t used = 0;
+};
 
-        // Draw the rest of the body.
-        for (size_t i = 1; i < snakeBody.size(); ++i) {
-            displayWorld[snakeBody[i].y][snakeBody[i].x] = SNAKE_BODY_CHAR;
-        }
+// Which color a cell is drawn in, neighbours of the same color share one
+// escape sequence.
+enum CellColor { PLAIN, SNAKE_COLOR, FOOD_COLOR };
+
+const size_t STATUS_BYTES = 256; // room for the text lines under the world
+
+char& cellAt(World& world, int x, int y) {
+    return world.cells[static_cast<size_t>(y) * world.width + x];
+}
+
+// Bytes needed for the biggest frame: every cell switching color (5 byte
+// escape + the char), the borders and the status lines.
+size_t frameCapacity(const World& world) {
+    size_t row = 2 + world.width * (sizeof(GREEN_TEXT) - 1 + 1) + (sizeof(RESET_COLOR) - 1) + 3;
+    size_t border = world.width + 5;
+    return sizeof(CLEAR_SCREEN CURSOR_HOME) + 2 * border + world.height * row + STATUS_BYTES;
+}
+
+void appendBytes(FrameBuffer& frame, const char* text, size_t length) {
+    length = std::min(length, frame.bytes.size() - frame.used); // can't happen, see frameCapacity
+    std::memcpy(frame.bytes.data() + frame.used, text, length);
+    frame.used += length;
+}
+
+void appendText(FrameBuffer& frame, const char* text) {
+    appendBytes(frame, text, std::strlen(text));
+}
+
+void appendBorder(FrameBuffer& frame, int width) {
+    size_t length = std::min<size_t>(width + 4, frame.bytes.size() - frame.used);
+    std::memset(frame.bytes.data() + frame.used, '-', length);
+    frame.used += length;
+    appendBytes(frame, "\n", 1);
+}
+
+// switch the terminal to 'color' if it isn't in it already
+void setColor(FrameBuffer& frame, CellColor& current, CellColor color) {
+    if (color == current) return;
+    appendText(frame, color == SNAKE_COLOR ? GREEN_TEXT : color == FOOD_COLOR ? RED_TEXT : RESET_COLOR);
+    current = color;
+}
+
+// hand the finished frame to the terminal
+void flushFrame(const FrameBuffer& frame) {
+    size_t done = 0;
+    while (done < frame.used) {
+        ssize_t n = write(STDOUT_FILENO, frame.bytes.data() + done, frame.used - done);
+        if (n <= 0) return; // nothing sensible to do if the terminal went away
+        done += n;
     }
+}
 
-    // Print the border and the contents of the display world.
-    std::cout << "--------------------" << std::endl;
-    for (size_t y = 0; y < displayWorld.size(); ++y) {
-        std::cout << "| "; // Left border
-        for (size_t x = 0; x < displayWorld[y].size(); ++x) {
-            if (displayWorld[y][x] == FOOD_CHAR) {
-                std::cout << RED_TEXT << displayWorld[y][x] << RESET_COLOR;
-            } else if (displayWorld[y][x] == SNAKE_HEAD_CHAR) {
-                std::cout << GREEN_TEXT << displayWorld[y][x] << RESET_COLOR;
-            } else if (displayWorld[y][x] == SNAKE_BODY_CHAR) {
-                std::cout << GREEN_TEXT << displayWorld[y][x] << RESET_COLOR;
-            } else {
-                std::cout << displayWorld[y][x];
+
+// Move snake 'id' to 'head', the segment entering at tick 'entry', and keep
+// the occupancy grid in step.
+void pushHead(SnakeGrid& grid, const World& world, Snake& snake, int id, Point head, unsigned entry) {
+    snake.body.insert(snake.body.begin(), head); // capacity is reserved, no allocation
+    size_t cell = static_cast<size_t>(head.y) * world.width + head.x;
+    if (grid.segments[cell]++ == 0) grid.occupied++;
+    grid.lastEntry[cell] = entry;
+    grid.owner[cell] = id;
+}
+
+void popTail(SnakeGrid& grid, const World& world, Snake& snake) {
+    Point tail = snake.body.back();
+    if (--grid.segments[static_cast<size_t>(tail.y) * world.width + tail.x] == 0) grid.occupied--;
+    snake.body.pop_back();
+}
+
+// Function to draw the game world, including the snakes and food.
+// The snakes are composited while printing from the occupancy grid, a cell
+// entered this tick is a head. 'message' is an extra line, or nullptr.
+void drawWorld(FrameBuffer& frame, const World& world, const SnakeGrid& grid,
+               const std::vector<Snake>& snakes, size_t frameAllocations, const char* message) {
+    frame.used = 0;
+    // Always clear the screen before redrawing to prevent flickering
+    appendText(frame, CLEAR_SCREEN CURSOR_HOME);
+
+    // Print the border and the contents of the world.
+    appendBorder(frame, world.width);
+    for (int y = 0; y < world.height; ++y) {
+        appendText(frame, "| "); // Left border
+        CellColor color = PLAIN;
+        size_t rowStart = static_cast<size_t>(y) * world.width;
+        for (size_t i = rowStart; i < rowStart + world.width; ++i) {
+            char cell = world.cells[i];
+            CellColor cellColor = cell == FOOD_CHAR ? FOOD_COLOR : PLAIN;
+            if (grid.segments[i] > 0) {
+                cell = grid.lastEntry[i] == grid.tick ? SNAKE_HEAD_CHAR : SNAKE_BODY_CHAR;
+                cellColor = SNAKE_COLOR;
             }
+            // Blanks look the same in any color, so they don't break a run.
+            if (cell != ' ') {
+                setColor(frame, color, cellColor);
+            }
+            appendBytes(frame, &cell, 1);
+        }
+        setColor(frame, color, PLAIN);
+        appendText(frame, " |\n"); // Right border
+    }
+    appendBorder(frame, world.width);
+
+    char status[STATUS_BYTES];
+    int length;
+    if (snakes.size() == 1) {
+        length = std::snprintf(status, sizeof(status), "Snake length: %zu\n", snakes[0].body.size());
+    } else {
+        size_t alive = 0, longest = 0;
+        for (const Snake& snake : snakes) {
+            alive += !snake.body.empty();
+            longest = std::max(longest, snake.body.size());
+        }
+        length = std::snprintf(status, sizeof(status), "Snakes alive: %zu of %zu, longest: %zu\n",
+                               alive, snakes.size(), longest);
+    }
+    length = std::max(length, 0);
+    length += std::snprintf(status + length, sizeof(status) - length, "Heap allocations last frame: %zu\n%s%s",
+                            frameAllocations, message ? message : "", message ? "\n" : "");
+    appendBytes(frame, status, std::min<size_t>(std::max(length, 0), sizeof(status) - 1));
+    flushFrame(frame);
+}
+
+
+// Set up an empty index for about 'expectedFood' items.
+void initFoodIndex(FoodIndex& index, const World& world, int expectedFood) {
+    double cellsPerFood = double(world.width) * world.height / std::max(expectedFood, 1);
+    index.bucketSize = std::max(4, static_cast<int>(std::ceil(std::sqrt(cellsPerFood))));
+    index.bucketsX = (world.width + index.bucketSize - 1) / index.bucketSize;
+    index.bucketsY = (world.height + index.bucketSize - 1) / index.bucketSize;
+    index.bucketHead.assign(static_cast<size_t>(index.bucketsX) * index.bucketsY, -1);
+    index.items.clear();
+    index.items.reserve(expectedFood);
+    index.freeItem = -1;
+    index.count = 0;
+}
+
+int& bucketOf(FoodIndex& index, Point position) {
+    return index.bucketHead[static_cast<size_t>(position.y / index.bucketSize) * index.bucketsX +
+                            position.x / index.bucketSize];
+}
+
+void addFood(FoodIndex& index, Point position) {
+    int item;
+    if (index.freeItem >= 0) {
+        item = index.freeItem;
+        index.freeItem = index.items[item].next;
+    } else {
+        item = static_cast<int>(index.items.size());
+        index.items.push_back({position, -1}); // only past the reserved size
+    }
+    int& head = bucketOf(index, position);
+    index.items[item] = {position, head};
+    head = item;
+    index.count++;
+}
+
+void removeFood(FoodIndex& index, Point position) {
+    for (int* link = &bucketOf(index, position); *link >= 0; link = &index.items[*link].next) {
+        FoodItem& food = index.items[*link];
+        if (food.position.x == position.x && food.position.y == position.y) {
+            int item = *link;
+            *link = food.next;
+            food.next = index.freeItem;
+            index.freeItem = item;
+            index.count--;
+            return;
         }
-        std::cout << " |" << std::endl; // Right border
     }
-    std::cout << "--------------------" << std::endl;
-    std::cout << "Snake length: " << snakeBody.size() << std::endl;
 }
 
 // Function to find the nearest food item to the snake's head.
-Point findNearestFood(const std::vector<std::vector<char>>& world, const Point& snakeHead) {
+// Distances are compared squared, as integers. On a tie the food on the
+// lower row (then column) wins, which is what scanning the world row by row
+// used to pick, so the snake takes the same path as before.
+Point findNearestFood(const FoodIndex& index, const Point& snakeHead) {
     Point nearestFood = {-1, -1};
-    double minDistance = -1;
-
-    for (size_t y = 0; y < world.size(); ++y) {
-        for (size_t x = 0; x < world[y].size(); ++x) {
-            if (world[y][x] == FOOD_CHAR) {
-                // Calculate the Euclidean distance.
-                double distance = std::sqrt(std::pow(x - snakeHead.x, 2) + std::pow(y - snakeHead.y, 2));
-                if (nearestFood.x == -1 || distance < minDistance) {
-                    minDistance = distance;
-                    nearestFood = {static_cast<int>(x), static_cast<int>(y)};
+    long long best = -1;
+    int bx = snakeHead.x / index.bucketSize;
+    int by = snakeHead.y / index.bucketSize;
+
+    for (int ring = 0; ; ++ring) {
+        // Food in ring r is at least (r - 1) * bucketSize + 1 cells away on
+        // one axis, once that's beyond the best so far we're done.
+        if (best >= 0 && ring > 0) {
+            long long closest = static_cast<long long>(ring - 1) * index.bucketSize + 1;
+            if (closest * closest > best) break;
+        }
+        if (bx - ring < 0 && by - ring < 0 && bx + ring >= index.bucketsX && by + ring >= index.bucketsY) {
+            break; // the ring is outside the world on every side
+        }
+        for (int y = std::max(0, by - ring); y <= std::min(index.bucketsY - 1, by + ring); ++y) {
+            // inside the ring only the left & right columns are new
+            bool edgeRow = y == by - ring || y == by + ring;
+            int step = edgeRow ? 1 : 2 * ring;
+            for (int x = bx - ring; x <= bx + ring; x += std::max(step, 1)) {
+                if (x < 0 || x >= index.bucketsX) continue;
+                for (int item = index.bucketHead[static_cast<size_t>(y) * index.bucketsX + x]; item >= 0;
+                     item = index.items[item].next) {
+                    Point food = index.items[item].position;
+                    long long dx = food.x - snakeHead.x, dy = food.y - snakeHead.y;
+                    long long distance = dx * dx + dy * dy;
+                    if (best < 0 || distance < best ||
+                        (distance == best && (food.y < nearestFood.y || (food.y == nearestFood.y && food.x < nearestFood.x)))) {
+                        best = distance;
+                        nearestFood = food;
+                    }
                 }
             }
         }
@@ -114,77 +361,596 @@ Point getNextMove(const Point& snakePos, const Point& foodPos) {
     return nextPos;
 }
 
-// Function to place food randomly on the grid.
-void placeFoodRandomly(std::vector<std::vector<char>>& world, const std::vector<Point>& snakeBody) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> disX(0, world[0].size() - 1);
-    std::uniform_int_distribution<> disY(0, world.size() - 1);
+// The four moves, in the order the planner tries them.
+const int MOVE_X[4] = {1, -1, 0, 0};
+const int MOVE_Y[4] = {0, 0, 1, -1};
+
+void initPlanner(Planner& planner, const World& world) {
+    planner.visited.assign(world.cells.size(), 0);
+    planner.current.clear();
+    planner.next.clear();
+    // every cell is pushed at most once per search
+    planner.current.reserve(world.cells.size());
+    planner.next.reserve(world.cells.size());
+    planner.generation = 0;
+}
+
+// Ticks until 'cell' has no snake in it, 0 if it is free now. The newest
+// segment in a cell leaves last, it is (tick - lastEntry) behind the head
+// of its snake and leaves once the rest of that snake has passed.
+int freeAfter(const SnakeGrid& grid, const std::vector<Snake>& snakes, size_t cell) {
+    if (grid.segments[cell] == 0) return 0;
+    size_t length = snakes[grid.owner[cell]].body.size();
+    return static_cast<int>(length - (grid.tick - grid.lastEntry[cell]));
+}
+
+// A* from 'start' to 'target' on the 4-neighbour grid, where a body cell
+// can be entered once it has been vacated by the time the head gets there.
+// 'ahead' is how many ticks in the future the search starts, for asking
+// about a move before it's made. With unit steps and the Manhattan
+// heuristic, f = g + h only ever stays the same or grows by 2, so instead of
+// a heap the open set is two stacks: this f and the next one. Cells are
+// pushed once, when first reached, and the stack makes the search dive
+// towards the target on open ground. In a big world a target walled off by
+// other snakes would flood everything, so a search gives up after expanding
+// a fixed number of cells more than the straight distance.
+// Returns the first step of the path, or {-1, -1} if there is none (or
+// 'start' is already the target). Only reads the grid, so snakes can plan
+// side by side with one Planner each.
+Point planPath(Planner& planner, const World& world, const SnakeGrid& grid, const std::vector<Snake>& snakes,
+               Point start, int ahead, Point target) {
+    if (target.x == start.x && target.y == start.y) return {-1, -1};
+    if (++planner.generation >= (1u << 30)) {
+        std::fill(planner.visited.begin(), planner.visited.end(), 0);
+        planner.generation = 1;
+    }
+    planner.searches++;
+    const unsigned mark = planner.generation << 2;
+    const int width = world.width;
+    auto distance = [&](int x, int y) { return std::abs(x - target.x) + std::abs(y - target.y); };
+    long budget = 4096 + 16L * distance(start.x, start.y);
+
+    planner.current.clear();
+    planner.next.clear();
+    int first = start.y * width + start.x;
+    planner.visited[first] = mark;
+    planner.current.push_back(first);
+    int f = distance(start.x, start.y);
+
+    while (!planner.current.empty() && budget-- > 0) {
+        int cell = planner.current.back();
+        planner.current.pop_back();
+        planner.expanded++;
+        int x = cell % width, y = cell / width;
+        if (x == target.x && y == target.y) {
+            // walk back to the cell right after the start
+            while (true) {
+                unsigned from = planner.visited[cell] & 3;
+                int previous = cell - MOVE_Y[from] * width - MOVE_X[from];
+                if (previous == first) return {cell % width, cell / width};
+                cell = previous;
+            }
+        }
+        int arrival = f - distance(x, y) + 1; // g of the neighbours
+        for (unsigned move = 0; move < 4; ++move) {
+            int nx = x + MOVE_X[move], ny = y + MOVE_Y[move];
+            if (nx < 0 || ny < 0 || nx >= width || ny >= world.height) continue;
+            int neighbour = ny * width + nx;
+            if ((planner.visited[neighbour] & ~3u) == mark) continue;
+            if (freeAfter(grid, snakes, neighbour) > arrival + ahead) continue; // body still there
+            planner.visited[neighbour] = mark | move;
+            if (arrival + distance(nx, ny) == f) {
+                planner.current.push_back(neighbour);
+            } else {
+                planner.next.push_back(neighbour);
+            }
+        }
+        if (planner.current.empty()) {
+            std::swap(planner.current, planner.next);
+            f += 2;
+        }
+    }
+    return {-1, -1};
+}
+
+// Would the tail of snake 'id' still be reachable after moving its head to
+// 'step'? Plans from 'step' one tick ahead to the segment that will be the
+// tail then, so the grid isn't touched. A pocket can only close where the
+// head touches a body or a wall, so when nothing but the snake's own neck is
+// around 'step' the answer is yes without searching; on open ground that's
+// nearly every tick.
+bool tailReachableAfter(Planner& planner, const World& world, const SnakeGrid& grid,
+                        const std::vector<Snake>& snakes, int id, Point step) {
+    // the walls close pockets too
+    bool nearBody = step.x == 0 || step.y == 0 || step.x == world.width - 1 || step.y == world.height - 1;
+    for (int y = std::max(0, step.y - 1); y <= std::min(world.height - 1, step.y + 1) && !nearBody; ++y) {
+        for (int x = std::max(0, step.x - 1); x <= std::min(world.width - 1, step.x + 1); ++x) {
+            size_t around = static_cast<size_t>(y) * world.width + x;
+            // segments 0-2 (head & neck) are always next to the new head
+            if (grid.segments[around] > 0 && (grid.owner[around] != id || grid.tick - grid.lastEntry[around] > 2)) {
+                nearBody = true;
+                break;
+            }
+        }
+    }
+    if (!nearBody) return true;
+
+    const std::vector<Point>& body = snakes[id].body;
+    if (body.size() < 2) return true;
+    Point newTail = body[body.size() - 2];
+    return (newTail.x == step.x && newTail.y == step.y) ||
+           planPath(planner, world, grid, snakes, step, 1, newTail).x != -1;
+}
+
+// Pick the head's next cell: the shortest path to the nearest food that
+// doesn't go through a body, as long as the tail can still be reached
+// after the first step, so the snake doesn't crawl into a pocket it can't
+// leave. Otherwise follow the tail, which keeps opening up room. If even
+// that fails take any cell that is free right now, and only run into a
+// body when nothing else is left.
+Point planMove(Planner& planner, const World& world, const SnakeGrid& grid,
+               const std::vector<Snake>& snakes, int id, Point foodPos) {
+    const std::vector<Point>& body = snakes[id].body;
+    Point head = body.front();
+    if (foodPos.x != -1) {
+        Point step = planPath(planner, world, grid, snakes, head, 0, foodPos);
+        if (step.x != -1 && tailReachableAfter(planner, world, grid, snakes, id, step)) return step;
+    }
+    Point tail = body.back();
+    if (tail.x != head.x || tail.y != head.y) {
+        Point step = planPath(planner, world, grid, snakes, head, 0, tail);
+        if (step.x != -1) return step;
+    }
+    Point fallback = {-1, -1};
+    for (unsigned move = 0; move < 4; ++move) {
+        Point next = {head.x + MOVE_X[move], head.y + MOVE_Y[move]};
+        if (next.x < 0 || next.y < 0 || next.x >= world.width || next.y >= world.height) continue;
+        if (freeAfter(grid, snakes, static_cast<size_t>(next.y) * world.width + next.x) <= 1) return next;
+        if (fallback.x == -1) fallback = next;
+    }
+    return fallback;
+}
+
+// Function to place food randomly on the grid. The random numbers come from
+// 'gen' so a game started with the same seed places the same food.
+void placeFoodRandomly(World& world, const SnakeGrid& grid, FoodIndex& food, std::mt19937& gen, int foodWanted) {
+    std::uniform_int_distribution<> disX(0, world.width - 1);
+    std::uniform_int_distribution<> disY(0, world.height - 1);
 
     int foodCount = 0;
-    while (foodCount < FOOD_COUNT) {
+    while (foodCount < foodWanted) {
+        // stop instead of searching forever once snakes & food fill the world
+        if (grid.occupied + food.count >= world.cells.size()) return;
+
         int x = disX(gen);
         int y = disY(gen);
 
-        // Check if the spot is empty and not part of the snake
-        bool isSnake = false;
-        for (const auto& segment : snakeBody) {
-            if (segment.x == x && segment.y == y) {
-                isSnake = true;
-                break;
+        // Check if the spot is empty and not part of a snake
+        bool isSnake = grid.segments[static_cast<size_t>(y) * world.width + x] > 0;
+
+        if (cellAt(world, x, y) == ' ' && !isSnake) {
+            cellAt(world, x, y) = FOOD_CHAR;
+            addFood(food, {x, y});
+            foodCount++;
+        }
+    }
+}
+
+// Snakes are planned in the order of the chunk of the world their head is
+// in: every tick the live snakes are sorted by chunk, and the planning
+// threads take runs of PLAN_BATCH snakes off a shared counter. Snakes next
+// to each other in that order look at the same part of the grid, so a
+// thread keeps working in one area instead of all of them reading the whole
+// world. Only snakes are sorted and handed out, never the empty chunks, so a
+// tick costs the same in a small world as in a huge one.
+const int CHUNK_SIZE = 64;
+const size_t PLAN_BATCH = 16;
+
+// The threads that plan along with the main thread. They sleep until
+// 'round' changes, plan snakes until none are left and count 'working' down.
+struct PlanPool {
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned round = 0;
+    int working = 0;
+    bool stopping = false;
+};
+
+// Everything that makes up one running game.
+struct Game {
+    World world;
+    SnakeGrid grid;
+    std::vector<Snake> snakes;
+    std::vector<Point> moves;       // where each snake goes this tick
+    std::vector<char> eats;         // and whether it finds food there
+    FoodIndex food;
+    std::vector<Planner> planners;  // one per planning thread
+    int chunksX = 0;
+    std::vector<unsigned long long> order; // live snakes as chunk << 32 | id, sorted
+    std::atomic<size_t> nextSnake{0};
+    PlanPool pool;
+    std::mt19937 gen;
+    bool greedy = false;     // use the old greedy getNextMove instead of planning
+    int foodWanted = 0;
+    long foodEaten = 0;
+    long collisions = 0;     // snakes that died moving into a body
+    long ticks = 0;
+    long firstCollision = -1; // tick of the first collision
+    size_t firstCollisionLength = 0;
+};
+
+// Put snake 'id' in the world three cells long, head at 'head' and the body
+// below it, as if it had just crawled up.
+void placeSnake(Game& game, int id, Point head) {
+    for (int k = 2; k >= 0; --k) {
+        pushHead(game.grid, game.world, game.snakes[id], id, {head.x, head.y + k}, game.grid.tick - k);
+    }
+}
+
+// Find a free spot for a dead snake. Gives up after a few tries in a crowded
+// world, the snake then tries again next tick.
+bool respawnSnake(Game& game, int id) {
+    std::uniform_int_distribution<> disX(0, game.world.width - 1);
+    std::uniform_int_distribution<> disY(0, game.world.height - 3);
+    for (int attempt = 0; attempt < 64; ++attempt) {
+        int x = disX(game.gen), y = disY(game.gen);
+        bool free = true;
+        for (int k = 0; k < 3 && free; ++k) {
+            size_t cell = static_cast<size_t>(y + k) * game.world.width + x;
+            free = game.grid.segments[cell] == 0 && game.world.cells[cell] == ' ';
+        }
+        if (free) {
+            placeSnake(game, id, {x, y});
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pick the next cell of every snake in the runs of 'order' this thread gets.
+void planSnakes(Game& game, Planner& planner) {
+    size_t count = game.order.size();
+    for (size_t first; (first = game.nextSnake.fetch_add(PLAN_BATCH, std::memory_order_relaxed)) < count;) {
+        for (size_t i = first; i < std::min(first + PLAN_BATCH, count); ++i) {
+            int id = static_cast<int>(game.order[i] & 0xffffffffu);
+            Point head = game.snakes[id].body.front();
+            // Find the nearest food item for the snake to chase.
+            Point foodLocation = findNearestFood(game.food, head);
+            Point next = game.greedy ? getNextMove(head, foodLocation)
+                                     : planMove(planner, game.world, game.grid, game.snakes, id, foodLocation);
+            game.moves[id] = next.x == -1 ? head : next; // boxed in on a 1 cell world, can't happen here
+        }
+    }
+}
+
+void planWorker(Game& game, int worker) {
+    unsigned seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> hold(game.pool.lock);
+            game.pool.wake.wait(hold, [&] { return game.pool.stopping || game.pool.round != seen; });
+            if (game.pool.stopping) return;
+            seen = game.pool.round;
+        }
+        planSnakes(game, game.planners[worker]);
+        std::lock_guard<std::mutex> hold(game.pool.lock);
+        if (--game.pool.working == 0) game.pool.done.notify_one();
+    }
+}
+
+void stopPlanThreads(Game& game) {
+    {
+        std::lock_guard<std::mutex> hold(game.pool.lock);
+        game.pool.stopping = true;
+    }
+    game.pool.wake.notify_all();
+    for (std::thread& thread : game.pool.threads) thread.join();
+    game.pool.threads.clear();
+}
+
+// Plan every snake's move. Planning only reads the world, so all threads
+// share it and each writes just the moves of its own snakes.
+void planAll(Game& game) {
+    game.order.clear(); // keeps its capacity, so no allocation
+    for (size_t id = 0; id < game.snakes.size(); ++id) {
+        if (game.snakes[id].body.empty()) continue;
+        Point head = game.snakes[id].body.front();
+        unsigned long long chunk = static_cast<unsigned long long>(head.y / CHUNK_SIZE) * game.chunksX + head.x / CHUNK_SIZE;
+        game.order.push_back(chunk << 32 | id);
+    }
+    std::sort(game.order.begin(), game.order.end());
+    game.nextSnake.store(0, std::memory_order_relaxed);
+
+    if (game.pool.threads.empty()) {
+        planSnakes(game, game.planners[0]);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> hold(game.pool.lock);
+        game.pool.round++;
+        game.pool.working = static_cast<int>(game.pool.threads.size());
+    }
+    game.pool.wake.notify_all();
+    planSnakes(game, game.planners[0]);
+    std::unique_lock<std::mutex> hold(game.pool.lock);
+    game.pool.done.wait(hold, [&] { return game.pool.working == 0; });
+}
+
+void startGame(Game& game, int width, int height, int foodWanted, int snakeCount, int threads, unsigned seed) {
+    // Create our game world as one flat grid of characters.
+    game.world = {width, height, std::vector<char>(static_cast<size_t>(width) * height, ' ')};
+    game.grid.segments.assign(game.world.cells.size(), 0);
+    game.grid.lastEntry.assign(game.world.cells.size(), 0);
+    game.grid.owner.assign(game.world.cells.size(), 0);
+    game.grid.tick = 2; // the first snakes' tails entered at tick 0
+    game.grid.occupied = 0;
+    game.planners.resize(threads);
+    for (Planner& planner : game.planners) initPlanner(planner, game.world);
+    game.gen.seed(seed);
+    game.foodWanted = foodWanted;
+    game.foodEaten = 0;
+    game.collisions = 0;
+    game.ticks = 0;
+    game.firstCollision = -1;
+
+    game.chunksX = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    game.order.clear();
+    game.order.reserve(snakeCount);
+    game.moves.assign(snakeCount, {-1, -1});
+    game.eats.assign(snakeCount, 0);
+
+    // Each snake is a vector of points, representing each segment, head
+    // first. Reserve room for a snake to fill the world, or with many snakes
+    // a few times its share of it, so growing doesn't allocate.
+    size_t reserve = snakeCount == 1 ? game.world.cells.size() + 1
+                                     : 4 * game.world.cells.size() / snakeCount + 64;
+    game.snakes.assign(snakeCount, Snake());
+    for (Snake& snake : game.snakes) snake.body.reserve(reserve);
+    placeSnake(game, 0, {5, 5}); // the first snake where it always started
+    for (int id = 1; id < snakeCount; ++id) {
+        respawnSnake(game, id);
+    }
+
+    // Place some "food" characters randomly in the world.
+    initFoodIndex(game.food, game.world, foodWanted);
+    placeFoodRandomly(game.world, game.grid, game.food, game.gen, foodWanted);
+
+    for (int worker = 1; worker < threads; ++worker) {
+        game.pool.threads.emplace_back(planWorker, std::ref(game), worker);
+    }
+}
+
+// Move every snake one step, returns how much food was eaten. The moves are
+// planned in parallel against the world as it was at the start of the tick,
+// then applied here one snake after the other in id order, so the outcome
+// doesn't depend on the number of threads: tails move first, then a head
+// moving into a cell that's still taken (by any snake, also one that got
+// there earlier this tick) kills its snake, which comes back somewhere else.
+long tickGame(Game& game) {
+    planAll(game);
+    game.ticks++;
+
+    std::vector<Snake>& snakes = game.snakes;
+    for (size_t id = 0; id < snakes.size(); ++id) {
+        if (snakes[id].body.empty()) continue;
+        Point next = game.moves[id];
+        // Snakes that eat keep their tail, so they grow.
+        game.eats[id] = cellAt(game.world, next.x, next.y) == FOOD_CHAR;
+        if (!game.eats[id]) popTail(game.grid, game.world, snakes[id]);
+    }
+    game.grid.tick++;
+
+    long eaten = 0;
+    for (size_t id = 0; id < snakes.size(); ++id) {
+        Snake& snake = snakes[id];
+        if (snake.body.empty()) continue;
+        Point next = game.moves[id];
+        if (game.grid.segments[static_cast<size_t>(next.y) * game.world.width + next.x] > 0) {
+            if (game.collisions++ == 0) {
+                game.firstCollision = game.ticks - 1;
+                game.firstCollisionLength = snake.body.size() + !game.eats[id];
             }
+            while (!snake.body.empty()) popTail(game.grid, game.world, snake);
+            continue;
+        }
+        pushHead(game.grid, game.world, snake, static_cast<int>(id), next, game.grid.tick);
+        if (game.eats[id] && cellAt(game.world, next.x, next.y) == FOOD_CHAR) {
+            // remove the food from the world, a new one comes below
+            cellAt(game.world, next.x, next.y) = ' ';
+            removeFood(game.food, next);
+            snake.foodEaten++;
+            eaten++;
         }
+    }
+    // the dead come back once everyone has moved, also those that found no
+    // room on an earlier tick
+    for (size_t id = 0; id < snakes.size(); ++id) {
+        if (snakes[id].body.empty()) respawnSnake(game, static_cast<int>(id));
+    }
 
-        if (world[y][x] == ' ' && !isSnake) {
-            world[y][x] = FOOD_CHAR;
-            foodCount++;
+    // Put new food somewhere else, so there is always something to chase.
+    game.foodEaten += eaten;
+    placeFoodRandomly(game.world, game.grid, game.food, game.gen, game.foodWanted - static_cast<int>(game.food.count));
+    return eaten;
+}
+
+// FNV-1a over all snakes, a short fingerprint of where the game ended up
+unsigned long long gameFingerprint(const Game& game) {
+    unsigned long long fingerprint = 14695981039346656037ull;
+    for (const Snake& snake : game.snakes) {
+        for (const Point& segment : snake.body) {
+            fingerprint = (fingerprint ^ static_cast<unsigned>(segment.x)) * 1099511628211ull;
+            fingerprint = (fingerprint ^ static_cast<unsigned>(segment.y)) * 1099511628211ull;
         }
+        fingerprint = (fingerprint ^ snake.body.size()) * 1099511628211ull;
     }
+    return fingerprint;
 }
 
-int main() {
+// Run 'ticks' ticks as fast as possible without drawing and report how it
+// went. The same seed & arguments always give the same game, whatever the
+// number of threads, so the summary line can be compared between builds.
+int runHeadless(Game& game, long ticks, unsigned seed) {
+    size_t allocationsBefore = allocationCount;
+    auto started = std::chrono::steady_clock::now();
+    for (long t = 0; t < ticks; ++t) {
+        tickGame(game);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    size_t allocations = allocationCount - allocationsBefore;
+    long searches = 0, expanded = 0;
+    for (const Planner& planner : game.planners) {
+        searches += planner.searches;
+        expanded += planner.expanded;
+    }
+    size_t snakeCount = game.snakes.size();
+    const Snake& first = game.snakes[0];
+
+    std::printf("seed %u, %dx%d world, %zu food, %zu snakes, %zu threads\n", seed, game.world.width,
+                game.world.height, game.food.count, snakeCount, game.planners.size());
+    std::printf("%ld ticks in %.3f s: %.0f ticks/s, %.3f us/tick, %.0f snake moves/s\n", ticks, seconds,
+                seconds > 0 ? ticks / seconds : 0.0, ticks ? seconds * 1e6 / ticks : 0.0,
+                seconds > 0 ? ticks * snakeCount / seconds : 0.0);
+    std::printf("food eaten: %ld, first snake length: %zu", game.foodEaten, first.body.size());
+    if (!first.body.empty()) {
+        std::printf(", head at (%d, %d)", first.body[0].x, first.body[0].y);
+    }
+    std::printf(", fingerprint %016llx\n", gameFingerprint(game));
+    std::printf("%s: %ld collisions with a body", game.greedy ? "greedy" : "planner", game.collisions);
+    if (game.firstCollision >= 0) {
+        std::printf(" (first at tick %ld, length %zu)", game.firstCollision, game.firstCollisionLength);
+    }
+    if (searches > 0) {
+        std::printf(", %ld searches expanding %.1f cells on average", searches, double(expanded) / searches);
+    }
+    std::printf("\n");
+    std::printf("heap allocations while ticking: %zu\n", allocations);
+    stopPlanThreads(game);
+    return 0;
+}
+
+// Run the same game with 1 to 32 planning threads and print how the snake
+// moves per second scale. Every run has to end in the same place.
+int runScaling(int width, int height, int foodWanted, int snakeCount, long ticks, unsigned seed, bool greedy) {
+    std::printf("seed %u, %dx%d world, %d food, %d snakes, %ld ticks, %u hardware threads\n", seed, width, height,
+                foodWanted, snakeCount, ticks, std::thread::hardware_concurrency());
+    double single = 0;
+    unsigned long long expected = 0;
+    bool same = true;
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        Game game;
+        startGame(game, width, height, foodWanted, snakeCount, threads, seed);
+        game.greedy = greedy;
+        auto started = std::chrono::steady_clock::now();
+        for (long t = 0; t < ticks; ++t) {
+            tickGame(game);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        stopPlanThreads(game);
+        double rate = seconds > 0 ? ticks * double(snakeCount) / seconds : 0.0;
+        if (threads == 1) {
+            single = rate;
+            expected = gameFingerprint(game);
+        }
+        unsigned long long fingerprint = gameFingerprint(game);
+        same = same && fingerprint == expected;
+        std::printf("%2d threads: %10.0f snake moves/s, %5.2fx, fingerprint %016llx\n", threads, rate,
+                    single > 0 ? rate / single : 0.0, fingerprint);
+    }
+    std::printf(same ? "all runs ended the same\n" : "runs ended differently!\n");
+    return same ? 0 : 1;
+}
+
+// usage: snek2 [--headless ticks] [--seed n] [--greedy] [--snakes n] [--threads n] [--scaling]
+//              [width] [height] [food]
+// 20x10 with 5 food and one snake by default. Without --seed every game is
+// different, --greedy brings back the old AI that ignores bodies. --scaling
+// runs the headless game (200 ticks unless --headless says otherwise) with
+// 1 to 32 threads.
+int main(int argc, char* argv[]) {
+    long headlessTicks = -1;
+    bool seeded = false;
+    bool greedy = false;
+    bool scaling = false;
+    int snakeCount = 1;
+    int threads = 1;
+    unsigned seed = 0;
+    std::vector<int> numbers;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless" && i + 1 < argc) {
+            headlessTicks = std::atol(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+            seeded = true;
+        } else if (arg == "--snakes" && i + 1 < argc) {
+            snakeCount = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::atoi(argv[++i]);
+        } else if (arg == "--greedy") {
+            greedy = true;
+        } else if (arg == "--scaling") {
+            scaling = true;
+        } else {
+            numbers.push_back(std::atoi(argv[i]));
+        }
+    }
+
     // Define the dimensions of our game world.
-    const int WORLD_WIDTH = 20;
-    const int WORLD_HEIGHT = 10;
+    int worldWidth = numbers.size() > 0 ? numbers[0] : 20;
+    int worldHeight = numbers.size() > 1 ? numbers[1] : 10;
+    int foodWanted = numbers.size() > 2 ? numbers[2] : FOOD_COUNT;
+    if (worldWidth < 8 || worldHeight < 8) {
+        std::cerr << "The world must be at least 8x8." << std::endl;
+        return 1;
+    }
+    if (foodWanted < 1 || foodWanted > worldWidth * worldHeight / 2) {
+        std::cerr << "The food has to fit in the world." << std::endl;
+        return 1;
+    }
+    if (snakeCount < 1 || 3L * snakeCount > static_cast<long>(worldWidth) * worldHeight / 4) {
+        std::cerr << "The snakes need room, at most one for every 12 cells." << std::endl;
+        return 1;
+    }
+    if (threads < 1 || threads > 256) {
+        std::cerr << "Use 1 to 256 threads." << std::endl;
+        return 1;
+    }
+    if (!seeded) {
+        seed = std::random_device()();
+    }
+    if (scaling) {
+        return runScaling(worldWidth, worldHeight, foodWanted, snakeCount, headlessTicks >= 0 ? headlessTicks : 200,
+                          seed, greedy);
+    }
 
-    // Create our 2D game world as a vector of vectors of characters.
-    std::vector<std::vector<char>> world(WORLD_HEIGHT, std::vector<char>(WORLD_WIDTH, ' '));
-    
-    // The snake is now a vector of points, representing each segment.
-    std::vector<Point> snakeBody = {{5, 5}, {5, 6}, {5, 7}}; // Initial snake with 3 segments.
+    Game game;
+    startGame(game, worldWidth, worldHeight, foodWanted, snakeCount, threads, seed);
+    game.greedy = greedy;
+    if (headlessTicks >= 0) {
+        return runHeadless(game, headlessTicks, seed);
+    }
 
-    // Place some "food" characters randomly in the world.
-    placeFoodRandomly(world, snakeBody);
+    FrameBuffer frame;
+    frame.bytes.resize(frameCapacity(game.world));
+    size_t frameAllocations = 0;
 
     // The main game loop.
     while (true) {
-        // Get the current position of the snake's head.
-        Point currentHead = snakeBody.front();
-        
-        // Find the nearest food item for the snake to chase.
-        Point foodLocation = findNearestFood(world, currentHead);
-
-        // Calculate the snake's next position based on the food location.
-        Point nextHeadPosition = getNextMove(currentHead, foodLocation);
-
-        // Add the new head position to the front of the snake's body vector.
-        snakeBody.insert(snakeBody.begin(), nextHeadPosition);
-
-        // Check if the snake has "eaten" the food.
-        bool ateFood = (foodLocation.x != -1 && nextHeadPosition.x == foodLocation.x && nextHeadPosition.y == foodLocation.y);
-        
-        if (ateFood) {
-            // If the snake ate food, remove the food from the world.
-            world[foodLocation.y][foodLocation.x] = ' ';
-            // Don't remove the tail, so the snake grows.
-            std::cout << "The snake ate the food! It will now find the next one." << std::endl;
-        } else {
-            // If the snake didn't eat, remove the last segment of the tail.
-            snakeBody.pop_back();
+        size_t allocationsBefore = allocationCount;
+        const char* message = nullptr;
+
+        if (tickGame(game) > 0) {
+            message = snakeCount == 1 ? "The snake ate the food! It will now find the next one."
+                                      : "Food was eaten! The snakes will now find the next one.";
         }
 
         // Draw the updated world.
-        drawWorld(world, snakeBody);
+        drawWorld(frame, game.world, game.grid, game.snakes, frameAllocations, message);
+        // shown on the next frame, this one is already on screen
+        frameAllocations = allocationCount - allocationsBefore;
 
         // Pause for a short duration to control the speed of the animation.
         std::this_thread::sleep_for(std::chrono::milliseconds(200));